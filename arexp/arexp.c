@@ -1,6 +1,7 @@
 /* arexp.c -- arithmetic expression calculator */
-/* reads options, intermediate operators, and expression strings
- * note: 'e' is translated to ^ because of cmd */
+/* reads options, intermediate operators, cell formulas, and expression strings
+ * note: 'e' is translated to ^ because of cmd, unless it's part of a name
+ * or stands where an operand is; the name of a cell is never translated */
 
 #include <stdio.h>
 #include <string.h>
@@ -8,12 +9,30 @@
 #include <stdbool.h>
 #include <ctype.h>
 #include "errchk.h"
+#include "translate.h"
 #include "eval.h"
+#include "pratt.h"
+#include "batch.h"
+#include "server.h"
+#include "stats.h"
+#include "cache.h"
+#include "cells.h"
+#include "par.h"
 
 // option flags
+#define BATCH		'b'
+#define DAEMON		'd'
+#define ENGINE		'E'
 #define HELP		'h'
+#define THREADS		'j'
+#define LIST		'l'
+#define MEMO		'm'
+#define NESTING		'n'
 #define ECHO		'o'
 #define F_PREC		'p'
+#define STATS		's'
+#define STATS_NOW	'S'
+#define TRACE		't'
 #define VER			'v'
 #define EXAMPLE		'x'
 
@@ -25,12 +44,20 @@
 #define MAX_PREC	10
 #define PREC_ERR	-2
 
-// the comment character; everything else after it is ignored
-#define COMMENT		'#'
+// the largest result cache and the error value for the option
+#define MAX_MEMO	(1 << 20)
+#define MEMO_ERR	-3
+
+// the most threads for a huge expression and the error value for the option
+#define MAX_THREADS	256
+#define THREADS_ERR	-4
+
+// the error value for the deepest nesting option
+#define NESTING_ERR	-5
 
 // print macros
 #define PROMPT 		printf("\r?> ")
-#define PRINT_RSLT	printf("result: %.*f\n", f_prec, curr_result)
+#define PRINT_RSLT	printf("result: %.*f\n", ctx.f_prec, curr_result)
 #define PRINT_VER	printf("%s %s\n", prog_name, prog_ver)
 
 // value indicating there's no intermediate operator
@@ -39,28 +66,46 @@
 // zero out the current result
 #define ZERO_OUT	'c'
 
-// this gets translated to '^'
-#define EXPON_OP	'e'
-
-// quits interactive mode
-#define QUIT		'q'
+// separates the name of a cell from its formula
+#define ASSIGN		'='
 
-// the expression buffer size
-#define BUFF_SIZE 	1023
+// the initial expression buffer size
+#define BUFF_SIZE 	1024
 
 // text buffer containing the expression
-static char expr_buff[BUFF_SIZE + 1];
+// grows as needed
+static char * expr_buff = NULL;
+static size_t buff_size = 0;
+
+// the engine state
+static Context ctx;
+
+// the compiled expression
+static comp_expr cexp;
+
+// results of the expressions seen so far; size 0 when it's off
+static Cache memo;
+
+// the named cells
+static Sheet sheet;
 
 // program info
 static char * prog_name = "arexp";
 static char * prog_ver = "v1.0";
 
 // default values
-int f_prec = 2; // see eval.h
 static bool echo = false;
 
-static int handle_arg(const char * arg);
+static int handle_arg(const char * arg, bool cmd_line);
 static int get_string(void);
+static int name_len(const char * str);
+static void assign(const char * name, int len, const char * formula);
+static void list_cells(void);
+static void buff_reserve(size_t len);
+static bool unbound(void);
+static int print_err(int code);
+static int calc(const char * expr, double * result);
+static void print_stats(void);
 static void print_help(void);
 static void print_example(void);
 
@@ -70,21 +115,54 @@ int main(int argc, char * argv[])
 	/* read arguments, intermediate operators, 
 	 * expression, check for errors, send for evaluation */
 	
+	context_init(&ctx);
+	comp_init(&cexp);
+	sheet_init(&sheet);
+	
 	// parse args in non-interactive mode
 	for (++argv; *argv != NULL; ++argv, --argc)
 	{
-		switch (handle_arg(*argv))
+		switch (handle_arg(*argv, true))
 		{
 			case HELP:
 			case EXAMPLE:
+			case LIST:
 			case VER:
 				return 0;
 				break;
 			case PREC_ERR:
+			case MEMO_ERR:
+			case THREADS_ERR:
+			case NESTING_ERR:
+				return -1;
+				break;
+			case BATCH:
+				// the file name follows the option or is the next argument
+				if ((*argv)[2] != '\0')
+					return batch_run(*argv + 2, ctx.f_prec, ctx.keep_stats);
+				if (*(argv + 1) != NULL)
+					return batch_run(*(argv + 1), ctx.f_prec, ctx.keep_stats);
+				fprintf(stderr, "Err: no file name given for -%c\n", BATCH);
+				return -1;
+				break;
+			case DAEMON:
+				// same as above, with the path of the socket
+				if ((*argv)[2] != '\0')
+					return server_run(*argv + 2, ctx.f_prec, ctx.keep_stats);
+				if (*(argv + 1) != NULL)
+					return server_run(*(argv + 1), ctx.f_prec, ctx.keep_stats);
+				fprintf(stderr, "Err: no socket given for -%c\n", DAEMON);
 				return -1;
 				break;
 			case ECHO:
+			case ENGINE:
 			case F_PREC:
+			case MEMO:
+			case THREADS:
+			case NESTING:
+			case STATS:
+			case STATS_NOW:
+			case TRACE:
 				break;
 			default:
 				goto out;
@@ -97,40 +175,46 @@ int main(int argc, char * argv[])
 	{
 		// get arguments in the expression buffer
 		double curr_result = 0.0;
-		int i, ch, j;
+		char ** arg;
+		size_t len;
+		int i, ch, j, ret;
+		
+		// make room for all of them and a space after each
+		for (len = 0, arg = argv; *arg != NULL; ++arg)
+			len += strlen(*arg) + 1;
+		buff_reserve(len);
 		
+		// the spaces keep apart names given as separate arguments
 		j = 0;
 		while (*(argv) != NULL)
 		{
-			for (i = 0; (ch = (*argv)[i]) != '\0' && j < BUFF_SIZE; ++i)
-			{
-				// translate exponent operator 
-				if (EXPON_OP == ch)
-					ch = '^';
-				// disregard spaces
-				if (!isspace(ch))
-					expr_buff[j++] = ch;
-			}	
+			for (i = 0; (ch = (*argv)[i]) != '\0'; ++i)
+				expr_buff[j++] = ch;
+			expr_buff[j++] = ' ';
 			++argv;
 		}
+		translate(expr_buff, &j, false);
 		// terminate string
-		expr_buff[j] = '\0';	
+		expr_buff[j] = '\0';
 		
 		// print
 		puts(expr_buff);
 		
-		// check for errors
-		if (errchk(expr_buff) != 0)
-			return 1;
+		// check for errors and evaluate
+		ret = calc(expr_buff, &curr_result);
 		
-		// evaluate
-		curr_result = calculate(expr_buff);
-		PRINT_RSLT;
+		if (0 == ret)
+			PRINT_RSLT;
+		
+		if (ctx.keep_stats)
+			print_stats();
+		
+		return ret;
 	}
 	else
 	{
 		// interactive use; get input from stdin
-		int str_ret, op;
+		int str_ret, op, len;
 		char * expr_start;
 		double curr_result, prev_result;
 		
@@ -148,19 +232,25 @@ int main(int argc, char * argv[])
 				continue;
 			
 			// check if a switch was entered
-			if (handle_arg(expr_buff) != NO_ARG)
+			if (handle_arg(expr_buff, false) != NO_ARG)
 				continue;
 			
 			// break on quit command or EOF
 			if (str_ret < 0)
 				break;
-			// exit on buffer overflow
-			else if (str_ret > 0)
-				return -1;
+			
+			// check for a formula for a cell
+			len = name_len(expr_buff);
+			if (len > 0 && ASSIGN == expr_buff[len])
+			{
+				assign(expr_buff, len, expr_buff + len + 1);
+				continue;
+			}
 			
 			expr_start = expr_buff;
-			// check for intermediate operator
-			if (strchr("ce*^/+-", *expr_start) != NULL)
+			// check for intermediate operator; the zero out is not a name
+			if (strchr("*^/+-", *expr_start) != NULL || 
+				(ZERO_OUT == *expr_start && 1 == len))
 			{
 				op = *expr_start;
 				if (ZERO_OUT == op)
@@ -177,25 +267,21 @@ int main(int argc, char * argv[])
 					continue;
 			}
 			
-			// error check past the operator if any
-			if (errchk(expr_start) != 0)
+			// error check, compile, and evaluate past the operator if any
+			if (calc(expr_start, &curr_result) != 0)
 				continue;
-			
-			// evaluate
-			curr_result = calculate(expr_start);
 			// the current result is the result of the expression
 			
 			if (op != NO_OP)
 			{
 				// place '<previous result> op <current result>' in the buffer
+				buff_reserve(snprintf(NULL, 0, "%.*f%c%.*f", 
+				ctx.f_prec, prev_result, op, ctx.f_prec, curr_result));
 				sprintf(expr_buff, "%.*f%c%.*f", 
-				f_prec, prev_result, op, f_prec, curr_result);
+				ctx.f_prec, prev_result, op, ctx.f_prec, curr_result);
 				
-				if (errchk(expr_buff) != 0)
+				if (calc(expr_buff, &curr_result) != 0)
 					continue;
-				
-				// evaluate
-				curr_result = calculate(expr_buff);
 				// the current result is the result of '<previous result> op <current result>'
 				
 				op = NO_OP;
@@ -204,14 +290,19 @@ int main(int argc, char * argv[])
 			PRINT_RSLT;
 		}
 		puts("Goodbye!");
+		
+		if (ctx.keep_stats)
+			print_stats();
 	}	
 	return 0;
 }
 
-static int handle_arg(const char * arg)
+static int handle_arg(const char * arg, bool cmd_line)
 {
-	/* argument handling */
-	int ret;
+	/* argument handling; an option is the whole argument, so one which
+	 * only begins like an option, e.g. -total, is an expression */
+	const char * rest;
+	int ret, size;
 	
 	// check for dash
 	if (*arg != '-')
@@ -219,6 +310,29 @@ static int handle_arg(const char * arg)
 	
 	// read next character
 	ret = *++arg;
+	rest = arg + 1;
+	switch (ret)
+	{
+		case BATCH:
+		case DAEMON:
+			// a file or a socket can follow; command line only
+			if (!cmd_line)
+				return NO_ARG;
+			break;
+		case MEMO:
+		case THREADS:
+		case NESTING:
+		case F_PREC:
+			// a number follows; without one, it's reported as invalid
+			if (strspn(rest, "0123456789") != strlen(rest))
+				return NO_ARG;
+			break;
+		default:
+			if (*rest != '\0')
+				return NO_ARG;
+			break;
+	}
+	
 	switch (*arg)
 	{
 		case ECHO:
@@ -233,15 +347,112 @@ static int handle_arg(const char * arg)
 				printf("Echo is now on\n");
 			}
 			break;
+		case TRACE:
+			// the steps cost nothing when they're not traced
+			if (ctx.verbose)
+			{
+				ctx.verbose = false;
+				printf("Trace is now off\n");
+			}
+			else
+			{
+				ctx.verbose = true;
+				printf("Trace is now on\n");
+			}
+			break;
+		case ENGINE:
+			if (ENGINE_PRATT == ctx.engine)
+			{
+				ctx.engine = ENGINE_QUEUES;
+				printf("Engine is now queues\n");
+			}
+			else
+			{
+				ctx.engine = ENGINE_PRATT;
+				printf("Engine is now pratt\n");
+			}
+			break;
+		case STATS:
+			if (ctx.keep_stats)
+			{
+				ctx.keep_stats = false;
+				printf("Stats are now off\n");
+			}
+			else
+			{
+				ctx.keep_stats = true;
+				printf("Stats are now on\n");
+			}
+			break;
+		case STATS_NOW:
+			print_stats();
+			break;
+		case LIST:
+			list_cells();
+			break;
+		case MEMO:
+			if (!isdigit((*(arg+1))) || sscanf((arg+1), "%d", &size) != 1 ||
+				size > MAX_MEMO)
+			{
+				fprintf(stderr, "Err: invalid cache size\n");
+				ret = MEMO_ERR;
+			}
+			else
+			{
+				// the old results go with the old cache
+				cache_destroy(&memo);
+				if (cache_init(&memo, size) != 0)
+				{
+					fprintf(stderr, "Err: memory allocation failed\n");
+					ret = MEMO_ERR;
+				}
+				else if (0 == size)
+					printf("Cache is now off\n");
+				else
+					printf("Cache size is set to %d\n", size);
+			}
+			break;
+		case THREADS:
+			if (!isdigit((*(arg+1))) || sscanf((arg+1), "%d", &size) != 1 ||
+				size < 1 || size > MAX_THREADS)
+			{
+				fprintf(stderr, "Err: invalid number of threads\n");
+				ret = THREADS_ERR;
+			}
+			else
+			{
+				ctx.par_threads = size;
+				printf("Threads for huge expressions are set to %d\n", size);
+			}
+			break;
+		case NESTING:
+			if (!isdigit((*(arg+1))) || sscanf((arg+1), "%d", &size) != 1 || size < 0)
+			{
+				fprintf(stderr, "Err: invalid nesting depth\n");
+				ret = NESTING_ERR;
+			}
+			else
+			{
+				ctx.max_depth = size;
+				if (0 == size)
+					printf("Nesting of parentheses is now unlimited\n");
+				else
+					printf("Nesting of parentheses is limited to %d\n", size);
+			}
+			break;
 		case F_PREC:
-			if (!isdigit((*(arg+1))) || sscanf((arg+1), "%d", &f_prec) != 1 ||
-				(f_prec < MIN_PREC || f_prec > MAX_PREC))
+			if (!isdigit((*(arg+1))) || sscanf((arg+1), "%d", &ctx.f_prec) != 1 ||
+				(ctx.f_prec < MIN_PREC || ctx.f_prec > MAX_PREC))
 			{
 				fprintf(stderr, "Err: invalid precision value\n");
 				ret = PREC_ERR;
 			}
 			else
-				printf("Precision is set to %d\n", f_prec);
+				printf("Precision is set to %d\n", ctx.f_prec);
+			break;
+		case BATCH:
+		case DAEMON:
+			// handled in main(); command line only
 			break;
 		case HELP:
 			print_help();
@@ -262,56 +473,69 @@ static int handle_arg(const char * arg)
 
 static int get_string(void)
 {
-	/* read input into the buffer */
-	int ch, ret, j;
+	/* read a line into the buffer */
+	int ch, ret, i, j, k, len;
+	bool eof;
 	
-	ret = j = 0;
+	j = 0;
+	eof = false;
 	PROMPT;
 	
 	while (true)
 	{
-		ch = getchar();
-		// translate exponent operator
-		if (EXPON_OP == ch)
-			ch = '^';
+		// room for this character and the terminating '\0'
+		buff_reserve(j + 1);
 		
-		if (QUIT == ch)
-		{
-			expr_buff[j++] = ch;
-			ret = -1;
-			break;
-		}
-		else if (EOF == ch)
-		{
-			// mark end of file to the user
-			expr_buff[j++] = 'e';
-			expr_buff[j++] = 'o';
-			expr_buff[j++] = 'f';
-			ret = -1;
-			break;
-		}
-		else if (j >= BUFF_SIZE)
+		ch = getchar();
+		if (EOF == ch)
 		{
-			// expression buffer overflow
-			fprintf(stderr, "Err: the expression is too long\n");
-			fprintf(stderr, "It should be no more than %d characters\n", BUFF_SIZE);
-			ret = 1;
+			eof = true;
 			break;
 		}
 		else if (COMMENT == ch)
 		{
 			// eat the line
-			while (ch != '\n')
+			while (ch != '\n' && ch != EOF)
 				ch = getchar();
 			break;
 		}
 		else if ('\n' == ch)
 			break;
-		else if (!isspace(ch))
+		else
 			expr_buff[j++] = ch;
 	}
+	// the name of a cell is taken as it is, even a lone QUIT or EXPON_OP,
+	// and only its formula is translated
+	expr_buff[j] = '\0';
+	for (i = 0; isspace((unsigned char)expr_buff[i]); ++i)
+		continue;
+	len = name_len(expr_buff + i);
+	for (k = i + len; isspace((unsigned char)expr_buff[k]); ++k)
+		continue;
+	if (len > 0 && ASSIGN == expr_buff[k])
+	{
+		memmove(expr_buff, expr_buff + i, len);
+		expr_buff[len] = ASSIGN;
+		j -= k + 1;
+		memmove(expr_buff + len + 1, expr_buff + k + 1, j);
+		ret = translate(expr_buff + len + 1, &j, false);
+		j += len + 1;
+	}
+	else
+	{
+		// translate the operators; the line ends at a quit
+		ret = translate(expr_buff, &j, true);
+	}
 	// terminate string
 	expr_buff[j] = '\0';
+	if (eof && 0 == ret)
+	{
+		// mark end of file to the user
+		j = strlen(expr_buff);
+		buff_reserve(j + 3);
+		strcpy(expr_buff + j, "eof");
+		ret = -1;
+	}
 	
 	// echo to stdout or not
 	if (echo)
@@ -320,13 +544,165 @@ static int get_string(void)
 	return ret;
 }
 
+static int name_len(const char * str)
+{
+	/* the length of the name str begins with, 0 if it doesn't */
+	int len = 0;
+	
+	if (IS_NAME_START(*str))
+	{
+		while (IS_NAME_CHAR(str[len]))
+			++len;
+	}
+	
+	return len;
+}
+
+static void assign(const char * name, int len, const char * formula)
+{
+	/* set the formula, then print every cell which has changed */
+	const char * undef;
+	int i, ret;
+	cell * c;
+	
+	if ( (ret = sheet_set(&sheet, &ctx, name, len, formula)) != ERR_NONE)
+	{
+		if (SHEET_CYCLE == ret)
+			fprintf(stderr, "Err: < %.*s > would depend on itself\n", len, name);
+		else
+			print_err(ret);
+		return;
+	}
+	
+	// the cells which read a cell without a formula are not a number
+	if ( (undef = sheet_undefined(&sheet, sheet_find(&sheet, name, len))) != NULL)
+		fprintf(stderr, "Err: < %s > has no value\n", undef);
+	
+	for (i = 0; i < sheet.n_order; ++i)
+	{
+		c = sheet.cells[sheet.order[i]];
+		printf("%s: %.*f\n", c->name, ctx.f_prec, c->value);
+	}
+	
+	return;
+}
+
+static void list_cells(void)
+{
+	/* in the order they were made */
+	cell * c;
+	int i;
+	
+	for (i = 0; i < sheet.n_cells; ++i)
+	{
+		c = sheet.cells[i];
+		if (c->defined)
+			printf("%s: %.*f (%s)\n", c->name, ctx.f_prec, c->value, c->formula);
+	}
+	
+	return;
+}
+
+static void buff_reserve(size_t len)
+{
+	/* make room for len characters and a '\0'; double the size */
+	char * new_buff;
+	size_t new_size;
+	
+	if (len < buff_size)
+		return;
+	
+	new_size = buff_size ? buff_size : BUFF_SIZE;
+	while (new_size <= len)
+		new_size *= 2;
+	
+	if ( (new_buff = realloc(expr_buff, new_size)) == NULL)
+	{
+		fprintf(stderr, "Err: memory allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+	expr_buff = new_buff;
+	buff_size = new_size;
+	
+	return;
+}
+
+static bool unbound(void)
+{
+	/* the names which aren't cells with formulas */
+	const char * name;
+	
+	if ( (name = comp_unbound(&cexp)) == NULL)
+		return false;
+	
+	fprintf(stderr, "Err: < %s > has no value\n", name);
+	return true;
+}
+
+static int print_err(int code)
+{
+	/* the engine doesn't print; unmatched parentheses have always gone to stdout */
+	char msg[ERR_MSG_SIZE];
+	
+	if (code != ERR_NONE)
+	{
+		err_format(&ctx, msg, sizeof(msg));
+		fputs(msg, (ERR_PARENS == code) ? stdout : stderr);
+	}
+	
+	return code;
+}
+
+static int calc(const char * expr, double * result)
+{
+	/* a cached result skips the check and the evaluation; the cache is left
+	 * alone while tracing, since the steps of a hit can't be printed; the
+	 * result of an expression which reads cells changes with them; the
+	 * single pass engine leaves those to compile() */
+	bool use_memo = (memo.size > 0 && !ctx.verbose);
+	int ret;
+	
+	if (use_memo && cache_get(&memo, expr, result))
+		return 0;
+	
+	if (ENGINE_PRATT == ctx.engine && !ctx.verbose && !ctx.keep_stats &&
+		(ret = pratt_calc(&ctx, expr, strlen(expr), result)) != PRATT_NAMES)
+	{
+		if (print_err(ret) != 0)
+			return 1;
+		if (use_memo)
+			cache_put(&memo, expr, *result);
+		return 0;
+	}
+	
+	if (print_err(compile(&ctx, &cexp, expr)) != 0)
+		return 1;
+	sheet_bind(&sheet, &cexp);
+	if (unbound())
+		return 1;
+	*result = evaluate(&ctx, &cexp);
+	
+	if (use_memo && 0 == cexp.n_vars)
+		cache_put(&memo, expr, *result);
+	return 0;
+}
+
+static void print_stats(void)
+{
+	/* the cache counts only when there's a cache */
+	stats_print(stderr, &ctx.stats);
+	if (memo.size > 0)
+		cache_print(stderr, &memo);
+	return;
+}
+
 static void print_help(void)
 {
 	/* print help info */
 	printf("%s -- infix arithmetic expression calculator\n", prog_name);
 	
 	printf("\nSupported operators:\n");
-	printf("^ or %c\t- exponentiation\n", EXPON_OP);
+	printf("^ or %c\t- exponentiation; %c followed by a letter or _ begins a name\n", EXPON_OP, EXPON_OP);
 	printf("*\t- multiplication\n");
 	printf("/\t- division\n");
 	printf("+\t- addition\n");
@@ -336,10 +712,35 @@ static void print_help(void)
 	printf("%c\t- comment; everything after it is ignored\n", COMMENT);
 	
 	printf("\nSupported options:\n");
+	printf("An option is the whole argument; -total, for example, is an expression.\n");
 	printf("-%c<number>\t- sets the number of digits displayed after the decimal point\n", F_PREC);
 	printf("\t\t <number> must be between %d and %d including.\n", MIN_PREC, MAX_PREC);
 	printf("-%c\t- toggles echo; when it's on everything entered is echoed\n", ECHO);
 	printf("\t to the screen. It's needed when the input is redirected.\n");
+	printf("-%c\t- toggles the trace; when it's on every operation is printed\n", TRACE);
+	printf("\t along with its result. It's on by default.\n");
+	printf("-%c\t- toggles the engine; when it's on an expression without names is\n", ENGINE);
+	printf("\t checked and evaluated in a single pass, with the same result.\n");
+	printf("\t Not used while the trace or the stats are on.\n");
+	printf("-%c\t- toggles stats; when they're on the expressions, numbers, and operators\n", STATS);
+	printf("\t are counted and the stages are timed. A summary is printed on stderr at exit.\n");
+	printf("-%c\t- prints the stats summary now\n", STATS_NOW);
+	printf("-%c\t- lists the cells with their formulas and values\n", LIST);
+	printf("-%c<number>\t- keeps the results of the last <number> different expressions, so\n", MEMO);
+	printf("\t\t one entered again isn't checked or evaluated; 0 turns it off, which is\n");
+	printf("\t\t the default. Not used while the trace is on. The hits and misses are\n");
+	printf("\t\t part of the stats summary.\n");
+	printf("-%c<number>\t- evaluates expressions of %d operations or more on <number>\n", THREADS, PAR_MIN_CODE);
+	printf("\t\t threads; 1 is the default. Long chains of + - or * are added up in\n");
+	printf("\t\t pieces, so the last digits can differ from those on one thread, but\n");
+	printf("\t\t not between runs. Not used while the trace is on.\n");
+	printf("-%c<number>\t- the deepest nesting of parentheses an expression can have;\n", NESTING);
+	printf("\t\t 0 is no limit but memory, %d is the default\n", DEF_MAX_DEPTH);
+	printf("-%c <file>\t- evaluates every line of <file> on all processors and prints\n", BATCH);
+	printf("\t\t the results in order; command line only, - is stdin\n");
+	printf("-%c <socket>\t- serves any number of clients on the Unix domain socket\n", DAEMON);
+	printf("\t\t <socket>; every line sent gets its result, or error, back as a line,\n");
+	printf("\t\t in order, as with -%c. Runs until interrupted; command line only\n", BATCH);
 	printf("-%c\t- this screen\n", HELP);
 	printf("-%c\t- print an example input file\n", EXAMPLE);
 	printf("-%c\t- print version info\n", VER);
@@ -376,6 +777,29 @@ static void print_help(void)
 	printf("?> q\n");
 	printf("Goodbye!\n");
 	
+	printf("\nIn interactive use a name can be given a formula with <name> %c <expression>.\n", ASSIGN);
+	printf("The names in the formula are other cells. When a cell changes, the cells\n");
+	printf("which depend on it are computed again and printed. Names can be used in\n");
+	printf("any expression. A cell can't depend on itself.\n");
+	printf("\nExample:\n");
+	printf("?> rate = 0.07\n");
+	printf("rate: 0.07\n");
+	printf("?> base = 100\n");
+	printf("base: 100.00\n");
+	printf("?> n = 2\n");
+	printf("n: 2.00\n");
+	printf("?> total = base * (1 + rate) ^ n\n");
+	printf("1.00 + 0.07 = 1.07\n");
+	printf("1.07 ^ 2.00 = 1.14\n");
+	printf("100.00 * 1.14 = 114.49\n");
+	printf("total: 114.49\n");
+	printf("?> rate = 0.1\n");
+	printf("1.00 + 0.10 = 1.10\n");
+	printf("1.10 ^ 2.00 = 1.21\n");
+	printf("100.00 * 1.21 = 121.00\n");
+	printf("rate: 0.10\n");
+	printf("total: 121.00\n");
+	
 	printf("\nVersion: %s\n", prog_ver);
 	return;
 }
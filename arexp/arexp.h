@@ -0,0 +1,33 @@
+/* arexp.h -- interface for libarexp */
+/* everything a program which embeds the engine needs; the library never
+ * prints and never stops the program, errors are left in the context as
+ * error codes with an offset in the expression, see context.h and errchk.h
+ *
+ * a typical use:
+ * 	Context ctx;
+ * 	comp_expr cexp;
+ * 	char msg[ERR_MSG_SIZE];
+ * 	double x = 2.0;
+ *
+ * 	context_init(&ctx);
+ * 	ctx.verbose = false;
+ * 	comp_init(&cexp);
+ * 	if (compile(&ctx, &cexp, "x*(x+1)") != ERR_NONE)
+ * 		err_format(&ctx, msg, sizeof(msg));
+ * 	else if (comp_bind(&cexp, "x", &x) == 0)
+ * 		x = evaluate(&ctx, &cexp);
+ * 	comp_destroy(&cexp);
+ * 	context_destroy(&ctx); */
+
+#ifndef AREXP_H_
+#define AREXP_H_
+
+#include "context.h"
+#include "errchk.h"
+#include "eval.h"
+#include "pratt.h"
+#include "veval.h"
+#include "stats.h"
+#include "cache.h"
+#include "cells.h"
+#endif
@@ -0,0 +1,471 @@
+/* batch.c -- evaluates files of expressions in parallel */
+/* works by mapping the whole file in memory, copy on write, or reading it when 
+ * it can't be mapped, like a pipe, and cutting it in chunks of whole lines; 
+ * every line is cleaned up and evaluated where it is; worker threads take the chunks in order, each with its own
+ * context, and print the results of a chunk in a buffer of its own;
+ * the main thread writes the buffers out in the order of the chunks */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+#include "context.h"
+#include "errchk.h"
+#include "eval.h"
+#include "stats.h"
+#include "translate.h"
+#include "batch.h"
+
+// the size of a result
+#define RSLT_SIZE	512
+
+// the approximate size of a chunk in bytes
+#define CHUNK_SIZE	(64 * 1024)
+
+// the size of a read when the file can't be mapped
+#define READ_SIZE	(1024 * 1024)
+
+// the results of a chunk
+typedef struct chunk_ {
+	char * start;
+	char * end;
+	batch_buff out;
+	long lines;
+	bool done;
+} chunk;
+
+// shared by all threads
+typedef struct batch_ {
+	chunk * chunks;
+	int n_chunks;
+	int next;
+	int f_prec;
+	bool stats;
+	ctx_stats total;
+	pthread_mutex_t lock;
+	pthread_cond_t chunk_done;
+} batch;
+
+// maps or reads the whole file; *mapped tells which
+static char * read_file(const char * fname, size_t * len, bool * mapped);
+
+// unmaps or frees what read_file() returned
+static void free_file(char * text, size_t len, bool mapped);
+
+// cuts the text in chunks of whole lines
+static chunk * make_chunks(char * text, size_t len, int * n_chunks);
+
+// the worker thread
+static void * worker(void * arg);
+
+// appends to an output buffer
+static void out_append(batch_buff * out, const char * str, size_t len);
+
+// joins the lines of a message of len characters, which ends in a new line
+static void one_line(char * msg, int len);
+
+// reports failed allocation and exits
+static void alloc_failed(void);
+
+/* --------------- MAIN CODE --------------- */
+int batch_run(const char * fname, int f_prec, bool stats)
+{
+	/* start the workers and write the chunks out in order */
+	struct timespec ts_start, ts_end;
+	pthread_t * threads;
+	batch bt;
+	char * text;
+	size_t len;
+	bool mapped;
+	long lines;
+	double secs;
+	int i, n_threads, n_started;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts_start);
+	
+	if ( (text = read_file(fname, &len, &mapped)) == NULL)
+		return -1;
+	
+	bt.chunks = make_chunks(text, len, &bt.n_chunks);
+	bt.next = 0;
+	bt.f_prec = f_prec;
+	bt.stats = stats;
+	memset(&bt.total, 0, sizeof(bt.total));
+	pthread_mutex_init(&bt.lock, NULL);
+	pthread_cond_init(&bt.chunk_done, NULL);
+	
+	n_threads = batch_threads();
+	if (n_threads > bt.n_chunks)
+		n_threads = bt.n_chunks;
+	
+	if ( (threads = malloc(n_threads * sizeof(*threads))) == NULL)
+		alloc_failed();
+	
+	// the workers which did start take all the chunks between them;
+	// if none did, this thread does them all before writing anything
+	for (n_started = 0; n_started < n_threads; ++n_started)
+	{
+		if (pthread_create(&threads[n_started], NULL, worker, &bt) != 0)
+			break;
+	}
+	if (0 == n_started)
+		worker(&bt);
+	n_threads = (n_started > 0) ? n_started : 1;
+	
+	// write out each chunk as soon as it's done
+	lines = 0;
+	for (i = 0; i < bt.n_chunks; ++i)
+	{
+		pthread_mutex_lock(&bt.lock);
+		while (!bt.chunks[i].done)
+			pthread_cond_wait(&bt.chunk_done, &bt.lock);
+		pthread_mutex_unlock(&bt.lock);
+		
+		fwrite(bt.chunks[i].out.text, 1, bt.chunks[i].out.len, stdout);
+		free(bt.chunks[i].out.text);
+		lines += bt.chunks[i].lines;
+	}
+	fflush(stdout);
+	
+	for (i = 0; i < n_started; ++i)
+		pthread_join(threads[i], NULL);
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts_end);
+	secs = (ts_end.tv_sec - ts_start.tv_sec) + (ts_end.tv_nsec - ts_start.tv_nsec) / 1e9;
+	fprintf(stderr, "%ld lines in %.3f s on %d threads, %.0f lines/s\n", 
+	lines, secs, n_threads, secs > 0 ? lines / secs : 0.0);
+	
+	// the times are added up over the threads
+	if (bt.stats)
+		stats_print(stderr, &bt.total);
+	
+	pthread_cond_destroy(&bt.chunk_done);
+	pthread_mutex_destroy(&bt.lock);
+	free(threads);
+	free(bt.chunks);
+	free_file(text, len, mapped);
+	
+	return 0;
+}
+
+static void * worker(void * arg)
+{
+	/* take chunks until there are none left */
+	batch * bt = (batch *)arg;
+	chunk * ch;
+	comp_expr cexp;
+	Context ctx;
+	int i;
+	
+	comp_init(&cexp);
+	context_init(&ctx);
+	ctx.verbose = false;
+	ctx.f_prec = bt->f_prec;
+	ctx.keep_stats = bt->stats;
+	
+	while (true)
+	{
+		pthread_mutex_lock(&bt->lock);
+		i = bt->next++;
+		pthread_mutex_unlock(&bt->lock);
+		
+		if (i >= bt->n_chunks)
+			break;
+		
+		ch = &bt->chunks[i];
+		ch->lines = batch_lines(&ctx, &cexp, ch->start, ch->end, &ch->out, false);
+		
+		pthread_mutex_lock(&bt->lock);
+		bt->chunks[i].done = true;
+		pthread_cond_broadcast(&bt->chunk_done);
+		pthread_mutex_unlock(&bt->lock);
+	}
+	
+	pthread_mutex_lock(&bt->lock);
+	stats_add(&bt->total, &ctx.stats);
+	pthread_mutex_unlock(&bt->lock);
+	
+	context_destroy(&ctx);
+	comp_destroy(&cexp);
+	return NULL;
+}
+
+long batch_lines(Context * ctx, comp_expr * cexp, char * start, char * end,
+	batch_buff * out, bool reply)
+{
+	/* clean up every line like get_string() does and evaluate it */
+	char rslt_buff[RSLT_SIZE];
+	char * pos = start, * eol, * expr;
+	int len, j;
+	long lines = 0;
+	
+	while (pos < end)
+	{
+		if ( (eol = memchr(pos, '\n', end - pos)) == NULL)
+			eol = end;
+		
+		// whitespace in front is stepped over, the rest is cleaned up
+		// where it is, which writes nothing in a line that's clean already
+		for (expr = pos; expr < eol && isspace((unsigned char)*expr); ++expr)
+			continue;
+		j = eol - expr;
+		translate(expr, &j, false);
+		pos = eol + 1;
+		
+		if (0 == j)
+		{
+			// a client matches the results to its lines by counting them
+			if (reply)
+				out_append(out, "\n", 1);
+			continue;
+		}
+		
+		++lines;
+		if (compile_len(ctx, cexp, expr, j) != 0)
+		{
+			len = err_format(ctx, rslt_buff, RSLT_SIZE);
+			if (reply)
+				one_line(rslt_buff, len);
+			out_append(out, rslt_buff, len);
+		}
+		else if (comp_unbound(cexp) != NULL)
+		{
+			// no way to give names values in a file; long names are cut short
+			len = snprintf(rslt_buff, RSLT_SIZE, "Err: < %.*s > has no value\n", 
+			RSLT_SIZE / 2, comp_unbound(cexp));
+			out_append(out, rslt_buff, len);
+		}
+		else
+		{
+			len = snprintf(rslt_buff, RSLT_SIZE, "%.*f\n", ctx->f_prec, evaluate(ctx, cexp));
+			out_append(out, rslt_buff, len);
+		}
+	}
+	
+	return lines;
+}
+
+static void out_append(batch_buff * out, const char * str, size_t len)
+{
+	/* grow the output buffer geometrically */
+	char * new_text;
+	size_t new_size;
+	
+	if (out->len + len > out->size)
+	{
+		new_size = out->size ? out->size * 2 : CHUNK_SIZE;
+		while (new_size < out->len + len)
+			new_size *= 2;
+		
+		if ( (new_text = realloc(out->text, new_size)) == NULL)
+			alloc_failed();
+		out->text = new_text;
+		out->size = new_size;
+	}
+	
+	memcpy(out->text + out->len, str, len);
+	out->len += len;
+	
+	return;
+}
+
+static void one_line(char * msg, int len)
+{
+	/* the new lines inside become spaces; the messages always fit */
+	int i;
+	
+	for (i = 0; i < len - 1; ++i)
+	{
+		if ('\n' == msg[i])
+			msg[i] = ' ';
+	}
+	return;
+}
+
+#ifdef _WIN32
+static char * read_file(const char * fname, size_t * len, bool * mapped)
+{
+	/* read the whole file in a buffer; "-" is stdin */
+	FILE * fp;
+	char * text = NULL, * new_text;
+	size_t size = 0, got;
+	
+	*mapped = false;
+	if (strcmp(fname, "-") == 0)
+		fp = stdin;
+	else if ( (fp = fopen(fname, "rb")) == NULL)
+	{
+		fprintf(stderr, "Err: can't open < %s >\n", fname);
+		return NULL;
+	}
+	
+	*len = 0;
+	do
+	{
+		if (*len + READ_SIZE > size)
+		{
+			size = size ? size * 2 : READ_SIZE;
+			if ( (new_text = realloc(text, size)) == NULL)
+				alloc_failed();
+			text = new_text;
+		}
+		got = fread(text + *len, 1, size - *len, fp);
+		*len += got;
+	} while (got > 0);
+	
+	if (ferror(fp))
+	{
+		fprintf(stderr, "Err: can't read < %s >\n", fname);
+		free(text);
+		text = NULL;
+	}
+	
+	if (fp != stdin)
+		fclose(fp);
+	
+	return text;
+}
+
+static void free_file(char * text, size_t len, bool mapped)
+{
+	/* never mapped here */
+	(void)len;
+	(void)mapped;
+	free(text);
+	return;
+}
+#else
+static char * read_file(const char * fname, size_t * len, bool * mapped)
+{
+	/* a regular file is mapped, so the lines are evaluated where they are
+	 * in the page cache; the mapping is private, so a page is copied only 
+	 * when a line on it is cleaned up; anything else, like a pipe, is read 
+	 * in a buffer with read(); "-" is stdin */
+	struct stat st;
+	char * text = NULL, * new_text;
+	size_t size = 0;
+	ssize_t got;
+	int fd;
+	
+	*mapped = false;
+	if (strcmp(fname, "-") == 0)
+		fd = STDIN_FILENO;
+	else if ( (fd = open(fname, O_RDONLY)) == -1)
+	{
+		fprintf(stderr, "Err: can't open < %s >\n", fname);
+		return NULL;
+	}
+	
+	// an empty file can't be mapped, and doesn't need to be
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		text = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (text != MAP_FAILED)
+		{
+			madvise(text, st.st_size, MADV_SEQUENTIAL);
+			*len = st.st_size;
+			*mapped = true;
+			if (fd != STDIN_FILENO)
+				close(fd);
+			return text;
+		}
+		text = NULL;
+	}
+	
+	*len = 0;
+	do
+	{
+		if (*len + READ_SIZE > size)
+		{
+			size = size ? size * 2 : READ_SIZE;
+			if ( (new_text = realloc(text, size)) == NULL)
+				alloc_failed();
+			text = new_text;
+		}
+		if ( (got = read(fd, text + *len, size - *len)) > 0)
+			*len += got;
+	} while (got > 0 || (-1 == got && EINTR == errno));
+	
+	if (-1 == got)
+	{
+		fprintf(stderr, "Err: can't read < %s >\n", fname);
+		free(text);
+		text = NULL;
+	}
+	
+	if (fd != STDIN_FILENO)
+		close(fd);
+	
+	return text;
+}
+
+static void free_file(char * text, size_t len, bool mapped)
+{
+	/* whichever way it was taken */
+	if (mapped)
+		munmap(text, len);
+	else
+		free(text);
+	return;
+}
+#endif
+
+static chunk * make_chunks(char * text, size_t len, int * n_chunks)
+{
+	/* every chunk ends at a new line, or at the end of the text */
+	char * pos = text, * end = text + len, * cut;
+	chunk * chunks;
+	int n;
+	
+	// there is at least one chunk, so the threads have something to do
+	n = len / CHUNK_SIZE + 1;
+	if ( (chunks = calloc(n, sizeof(*chunks))) == NULL)
+		alloc_failed();
+	
+	*n_chunks = 0;
+	do
+	{
+		cut = (end - pos > CHUNK_SIZE) ? pos + CHUNK_SIZE : end;
+		while (cut < end && *(cut - 1) != '\n')
+			++cut;
+		
+		chunks[*n_chunks].start = pos;
+		chunks[*n_chunks].end = cut;
+		++*n_chunks;
+		pos = cut;
+	} while (pos < end);
+	
+	return chunks;
+}
+
+static void alloc_failed(void)
+{
+	/* nothing sensible can be done */
+	fprintf(stderr, "Err: memory allocation failed\n");
+	exit(EXIT_FAILURE);
+}
+
+int batch_threads(void)
+{
+	/* at least one */
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? info.dwNumberOfProcessors : 1;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? n : 1;
+#endif
+}
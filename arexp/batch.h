@@ -0,0 +1,50 @@
+/* batch.h -- interface for batch.c */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "context.h"
+#include "eval.h"
+
+/* structure for a text buffer which grows as needed */
+typedef struct batch_buff_ {
+	char * text;
+	size_t len;
+	size_t size;
+} batch_buff;
+
+int batch_run(const char * fname, int f_prec, bool stats);
+/*
+returns: 0 if fname was read and evaluated, -1 otherwise
+
+description: Evaluates every line of the file fname on as many threads as 
+there are processors. A regular file is mapped in memory and its lines are 
+cleaned up and evaluated where they are; anything else is read. The result of 
+each line, or its error message, is printed on stdout in the order of the 
+lines. Lines are cleaned up by translate(), the same as in interactive use; 
+empty lines produce no output. The number of 
+lines per second is printed on stderr at the end, followed by the stats
+summary of all threads if stats is set.
+*/
+
+long batch_lines(Context * ctx, comp_expr * cexp, char * start, char * end,
+	batch_buff * out, bool reply);
+/*
+returns: the number of lines which weren't empty
+
+description: Evaluates the lines of the text from start to end with ctx and cexp,
+exactly like batch_run() does, and appends their results, or error messages, to 
+out. With reply set, every line gets exactly one line back instead: an empty 
+line for an empty line or a comment, and errors of two lines on one. The last 
+line doesn't need to end in a new line. The lines are cleaned up in place, so 
+the text is changed. Memory for out is taken with realloc(), so it can start 
+out zeroed.
+*/
+
+int batch_threads(void);
+/*
+returns: the number of threads batch_run() uses, the number of online processors
+*/
+#endif
@@ -0,0 +1,789 @@
+/* bench.c -- measures the speed of the expression engine */
+/* each section times one part of the engine and prints
+ * the results to stdout; run with no arguments for all sections
+ * or with the names of the sections to run */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "eval.h"
+#include "veval.h"
+#include "numconv.h"
+#include "errchk.h"
+#include "pcheck.h"
+#include "queue.h"
+#include "stack.h"
+#include "rqueue.h"
+#include "vstack.h"
+
+// the engine state
+static Context ctx;
+
+// a benchmark section
+typedef struct section_ {
+	const char * name;
+	void (*run)(void);
+} section;
+
+// expressions used by the sections
+static const char * formulas[] = {
+	"1+2*3",
+	"1.2+(3+1)^2",
+	"4/3*3.141592*5^3",
+	"1000*(1+0.07/12)^(12*30)-(1.0825^12)*250.5",
+	"(((1.5+2.25)*(3.125-4.0625))/-(0.5^2)+7*8/9-10)^2/(11+12*13)",
+};
+
+#define N_FORMULAS	(sizeof(formulas) / sizeof(*formulas))
+
+// returns the current time in seconds
+static double now(void);
+
+// calculate() from the string vs evaluate() of a compiled expression
+static void bench_compile(void);
+
+// heap allocations made by calculate() before and after warm up
+static void bench_pool(void);
+
+// compile and evaluate time of long chains of operators
+static void bench_chain(void);
+
+// numconv() against strtod(); the results must be the same to the bit
+static void bench_numconv(void);
+
+// evaluate_rows() against evaluate() on every row; the results must be the same
+static void bench_rows(void);
+
+// native code against the interpreter; the results must be the same
+static void bench_jit(void);
+
+// compile() with and without optimization; the results must be the same
+static void bench_opt(void);
+
+// a huge expression on one thread and on many; the results of many must be the same
+static void bench_par(void);
+
+// errchk() against errchk_par() on a huge expression; the errors and the
+// translated expressions must be the same
+static void bench_check(void);
+
+// the linked queue and stack against the ring queue and the vector stack,
+// filled and emptied the way compile() does; the order must be the same
+static void bench_containers(void);
+
+static section sections[] = {
+	{"compile", bench_compile},
+	{"pool", bench_pool},
+	{"chain", bench_chain},
+	{"numconv", bench_numconv},
+	{"rows", bench_rows},
+	{"jit", bench_jit},
+	{"opt", bench_opt},
+	{"par", bench_par},
+	{"check", bench_check},
+	{"containers", bench_containers},
+};
+
+#define N_SECTIONS	(sizeof(sections) / sizeof(*sections))
+
+// keeps the results alive
+static volatile double sink;
+
+/* --------------- MAIN CODE --------------- */
+int main(int argc, char * argv[])
+{
+	/* run the sections named in argv, or all of them */
+	int i, j;
+
+	context_init(&ctx);
+	ctx.verbose = false;
+
+	if (argc < 2)
+	{
+		for (j = 0; j < N_SECTIONS; ++j)
+			sections[j].run();
+		return 0;
+	}
+
+	for (i = 1; i < argc; ++i)
+	{
+		for (j = 0; j < N_SECTIONS; ++j)
+		{
+			if (strcmp(argv[i], sections[j].name) == 0)
+			{
+				sections[j].run();
+				break;
+			}
+		}
+
+		if (N_SECTIONS == j)
+		{
+			fprintf(stderr, "Err: unknown section < %s >\n", argv[i]);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static double now(void)
+{
+	/* monotonic time in seconds */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_compile(void)
+{
+	/* every formula is calculated from its string reps times, then
+	 * compiled once and evaluated reps times */
+	comp_expr cexp;
+	const int reps = 200000;
+	double t_calc, t_eval, start;
+	int i, j;
+
+	comp_init(&cexp);
+	printf("compile: %d repetitions per formula\n", reps);
+	printf("%-12s %-12s %-8s formula\n", "calculate", "evaluate", "speedup");
+	for (i = 0; i < N_FORMULAS; ++i)
+	{
+		start = now();
+		for (j = 0; j < reps; ++j)
+			sink = calculate(&ctx, formulas[i]);
+		t_calc = now() - start;
+
+		compile(&ctx, &cexp, formulas[i]);
+		start = now();
+		for (j = 0; j < reps; ++j)
+			sink = evaluate(&ctx, &cexp);
+		t_eval = now() - start;
+
+		printf("%-12.1f %-12.1f %-8.1f %s\n",
+		t_calc / reps * 1e9, t_eval / reps * 1e9, t_calc / t_eval, formulas[i]);
+	}
+	printf("(times are in ns per expression)\n");
+	comp_destroy(&cexp);
+	return;
+}
+
+static void bench_pool(void)
+{
+	/* calculate every formula reps times and count heap calls */
+	const int reps = 200000;
+	long warm, after;
+	double start, t;
+	int i, j;
+
+	// warm up the pool
+	for (i = 0; i < N_FORMULAS; ++i)
+		sink = calculate(&ctx, formulas[i]);
+	warm = ctx.pool.heap_calls + ctx.heap_calls;
+
+	start = now();
+	for (j = 0; j < reps; ++j)
+	{
+		for (i = 0; i < N_FORMULAS; ++i)
+			sink = calculate(&ctx, formulas[i]);
+	}
+	t = now() - start;
+	after = ctx.pool.heap_calls + ctx.heap_calls;
+
+	printf("pool: %d calculations\n", reps * (int)N_FORMULAS);
+	printf("heap calls during warm up: %ld\n", warm);
+	printf("heap calls after warm up: %ld\n", after - warm);
+	printf("%.1f ns per expression\n", t / (reps * N_FORMULAS) * 1e9);
+	return;
+}
+
+static void bench_chain(void)
+{
+	/* 1+1+...+1 and 1*1*...*1 with 10^3 to 10^6 operands;
+	 * the time per operand should stay about the same */
+	static const char ops[] = "+*";
+	comp_expr cexp;
+	char * buff;
+	double start, t_comp, t_eval;
+	int i, j, n, len;
+
+	comp_init(&cexp);
+	printf("chain: time per operand\n");
+	printf("%-4s %-10s %-12s %-12s\n", "op", "operands", "compile", "evaluate");
+	for (i = 0; ops[i] != '\0'; ++i)
+	{
+		for (n = 1000; n <= 1000000; n *= 10)
+		{
+			if ( (buff = malloc(2 * n)) == NULL)
+			{
+				fprintf(stderr, "Err: memory allocation failed\n");
+				exit(EXIT_FAILURE);
+			}
+
+			for (j = len = 0; j < n; ++j)
+			{
+				if (j > 0)
+					buff[len++] = ops[i];
+				buff[len++] = '1';
+			}
+			buff[len] = '\0';
+
+			// let the buffers grow first
+			compile(&ctx, &cexp, buff);
+
+			start = now();
+			compile(&ctx, &cexp, buff);
+			t_comp = now() - start;
+
+			start = now();
+			sink = evaluate(&ctx, &cexp);
+			t_eval = now() - start;
+
+			printf("%-4c %-10d %-12.1f %-12.1f\n", ops[i], n, t_comp / n * 1e9, t_eval / n * 1e9);
+			free(buff);
+		}
+	}
+	printf("(times are in ns per operand)\n");
+	comp_destroy(&cexp);
+	return;
+}
+
+static void bench_numconv(void)
+{
+	/* random numbers with up to max_digits digits, with and without
+	 * a fractional part, converted by both functions */
+	static const int max_digits[] = {6, 15, 40};
+	const int n_nums = 200000;
+	char * text, * pos, ** nums;
+	double start, t_conv, t_strtod, a, b;
+	long mismatches;
+	int i, j, k, n, len;
+
+	printf("numconv: %d numbers per row, compared bit for bit with strtod()\n", n_nums);
+	printf("%-8s %-12s %-12s %s\n", "digits", "numconv", "strtod", "mismatches");
+	for (i = 0; i < sizeof(max_digits) / sizeof(*max_digits); ++i)
+	{
+		text = malloc(n_nums * (max_digits[i] + 2));
+		nums = malloc(n_nums * sizeof(*nums));
+		if (NULL == text || NULL == nums)
+		{
+			fprintf(stderr, "Err: memory allocation failed\n");
+			exit(EXIT_FAILURE);
+		}
+
+		srand(i + 1);
+		for (j = 0, pos = text; j < n_nums; ++j)
+		{
+			nums[j] = pos;
+			n = rand() % max_digits[i] + 1;
+			for (k = 0; k < n; ++k)
+			{
+				// a decimal point somewhere in half of the numbers
+				if (k > 0 && 0 == rand() % (2 * n))
+					*pos++ = '.';
+				*pos++ = '0' + rand() % 10;
+			}
+			*pos++ = '\0';
+		}
+
+		mismatches = 0;
+		for (j = 0; j < n_nums; ++j)
+		{
+			a = numconv(nums[j], nums[j] + strlen(nums[j]), &len);
+			b = strtod(nums[j], NULL);
+			if (memcmp(&a, &b, sizeof(a)) != 0)
+			{
+				if (mismatches < 10)
+					fprintf(stderr, "Err: %s gives %.17g instead of %.17g\n", nums[j], a, b);
+				++mismatches;
+			}
+		}
+
+		start = now();
+		for (j = 0; j < n_nums; ++j)
+			sink = numconv(nums[j], nums[j] + max_digits[i] + 1, &len);
+		t_conv = now() - start;
+
+		start = now();
+		for (j = 0; j < n_nums; ++j)
+			sink = strtod(nums[j], NULL);
+		t_strtod = now() - start;
+
+		printf("%-8d %-12.1f %-12.1f %ld\n", max_digits[i],
+		t_conv / n_nums * 1e9, t_strtod / n_nums * 1e9, mismatches);
+
+		free(nums);
+		free(text);
+	}
+	printf("(times are in ns per number)\n");
+	return;
+}
+
+static void bench_rows(void)
+{
+	/* pricing rules over columns of random data */
+	static const char * rules[] = {
+		"price*qty*(1-disc/100)+fee",
+		"price*qty*(1-disc/100)*(1+tax)^years+fee",
+		"-(price-fee)/(qty+1)*(disc-50)/(tax+1)+price*price*qty",
+	};
+	static const char * names[] = {"price", "qty", "disc", "tax", "years", "fee"};
+	const long n_rows = 1000000;
+	const int n_cols = sizeof(names) / sizeof(*names);
+	double * cols[sizeof(names) / sizeof(*names)], * out;
+	int col_of[sizeof(names) / sizeof(*names)];
+	double start, t_rows, t_eval, r;
+	comp_expr cexp;
+	long mismatches, j;
+	int i, k;
+
+	out = malloc(n_rows * sizeof(*out));
+	for (k = 0; k < n_cols; ++k)
+		cols[k] = malloc(n_rows * sizeof(**cols));
+	for (k = 0; k < n_cols; ++k)
+	{
+		if (NULL == cols[k] || NULL == out)
+		{
+			fprintf(stderr, "Err: memory allocation failed\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	srand(1);
+	for (j = 0; j < n_rows; ++j)
+	{
+		cols[0][j] = (rand() % 100000) / 100.0;
+		cols[1][j] = rand() % 50 + 1;
+		cols[2][j] = rand() % 40;
+		cols[3][j] = (rand() % 25) / 100.0;
+		cols[4][j] = rand() % 10;
+		cols[5][j] = (rand() % 1000) / 100.0;
+	}
+
+	comp_init(&cexp);
+	printf("rows: %ld rows per rule, %s kernel\n", n_rows, rows_kernel());
+	printf("%-12s %-12s %-8s %-10s rule\n", "rows", "evaluate", "speedup", "mismatches");
+	for (i = 0; i < sizeof(rules) / sizeof(*rules); ++i)
+	{
+		compile(&ctx, &cexp, rules[i]);
+		for (k = 0; k < n_cols; ++k)
+			comp_bind(&cexp, names[k], cols[k]);
+		// the variables are in order of appearance
+		for (k = 0; k < cexp.n_vars; ++k)
+		{
+			for (col_of[k] = 0; cols[col_of[k]] != cexp.vars[k].src; ++col_of[k])
+				continue;
+		}
+
+		start = now();
+		evaluate_rows(&ctx, &cexp, out, n_rows);
+		t_rows = now() - start;
+
+		// one row at a time, binding the variables to the row
+		mismatches = 0;
+		start = now();
+		for (j = 0; j < n_rows; ++j)
+		{
+			for (k = 0; k < cexp.n_vars; ++k)
+				cexp.vars[k].src = cols[col_of[k]] + j;
+			r = evaluate(&ctx, &cexp);
+			if (memcmp(&r, &out[j], sizeof(r)) != 0)
+				++mismatches;
+		}
+		t_eval = now() - start;
+
+		printf("%-12.2f %-12.2f %-8.1f %-10ld %s\n", t_rows / n_rows * 1e9, 
+		t_eval / n_rows * 1e9, t_eval / t_rows, mismatches, rules[i]);
+	}
+	printf("(times are in ns per row)\n");
+
+	comp_destroy(&cexp);
+	for (k = 0; k < n_cols; ++k)
+		free(cols[k]);
+	free(out);
+	return;
+}
+
+static void bench_jit(void)
+{
+	/* every formula evaluated reps times by both; the chain shows the
+	 * cost per operation when there's a lot of them */
+	comp_expr interp, native;
+	const int reps = 1000000;
+	const int chain_len = 10000;
+	double t_interp, t_native, start, a, b;
+	const char * expr;
+	char * chain;
+	long mismatches;
+	int i, j;
+
+	if ( (chain = malloc(2 * chain_len + 1)) == NULL)
+	{
+		fprintf(stderr, "Err: memory allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+	for (j = 0; j < chain_len; ++j)
+	{
+		chain[2 * j] = "+-*/"[j % 4];
+		chain[2 * j + 1] = '1' + j % 9;
+	}
+	chain[2 * chain_len] = '\0';
+
+	comp_init(&interp);
+	comp_init(&native);
+	printf("jit: about %d operations per formula\n", reps);
+	printf("%-12s %-12s %-8s %-10s formula\n", "interpreter", "native", "speedup", "mismatches");
+	for (i = 0; i <= N_FORMULAS; ++i)
+	{
+		// the chain is last; skip its first operator
+		expr = (i < N_FORMULAS) ? formulas[i] : chain + 1;
+
+		ctx.jit = false;
+		compile(&ctx, &interp, expr);
+		ctx.jit = true;
+		compile(&ctx, &native, expr);
+		ctx.jit = false;
+
+		if (NULL == native.native)
+		{
+			printf("no native code on this machine\n");
+			break;
+		}
+
+		a = evaluate(&ctx, &interp);
+		b = evaluate(&ctx, &native);
+		mismatches = (memcmp(&a, &b, sizeof(a)) != 0);
+
+		start = now();
+		for (j = 0; j < reps / (native.n_code); ++j)
+			sink = evaluate(&ctx, &interp);
+		t_interp = now() - start;
+
+		start = now();
+		for (j = 0; j < reps / (native.n_code); ++j)
+			sink = evaluate(&ctx, &native);
+		t_native = now() - start;
+
+		printf("%-12.2f %-12.2f %-8.1f %-10ld %.*s%s\n", 
+		t_interp / reps * 1e9, t_native / reps * 1e9, t_interp / t_native, mismatches,
+		60, expr, strlen(expr) > 60 ? "..." : "");
+	}
+	printf("(times are in ns per operation)\n");
+
+	comp_destroy(&native);
+	comp_destroy(&interp);
+	free(chain);
+	return;
+}
+
+static void bench_opt(void)
+{
+	/* the formulas, and a generated one which repeats the same
+	 * subexpressions the way generated formulas do */
+	static const char * term = "+x*(1.0825^12)-(x+1)*(x+1)/(2^0.5)";
+	comp_expr plain, opt;
+	const int reps = 200000;
+	const int n_terms = 50;
+	double t_comp_plain, t_comp_opt, t_plain, t_opt, start, a, b, x = 1.5;
+	const char * expr;
+	char * gen;
+	int i, j;
+
+	if ( (gen = malloc(n_terms * strlen(term) + 1)) == NULL)
+	{
+		fprintf(stderr, "Err: memory allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+	for (j = 0, *gen = '\0'; j < n_terms; ++j)
+		strcat(gen, term);
+
+	comp_init(&plain);
+	comp_init(&opt);
+	printf("opt: %d repetitions per formula\n", reps);
+	printf("%-8s %-8s %-10s %-10s %-10s %-10s %-8s %s\n", "ops", "opt ops", "compile", 
+	"opt comp", "evaluate", "opt eval", "same", "formula");
+	for (i = 0; i <= N_FORMULAS; ++i)
+	{
+		// the generated formula is last; skip its first operator
+		expr = (i < N_FORMULAS) ? formulas[i] : gen + 1;
+
+		ctx.optimize = false;
+		start = now();
+		for (j = 0; j < reps; ++j)
+			compile(&ctx, &plain, expr);
+		t_comp_plain = now() - start;
+
+		ctx.optimize = true;
+		start = now();
+		for (j = 0; j < reps; ++j)
+			compile(&ctx, &opt, expr);
+		t_comp_opt = now() - start;
+		ctx.optimize = false;
+
+		comp_bind(&plain, "x", &x);
+		comp_bind(&opt, "x", &x);
+
+		start = now();
+		for (j = 0; j < reps; ++j)
+			sink = evaluate(&ctx, &plain);
+		t_plain = now() - start;
+
+		start = now();
+		for (j = 0; j < reps; ++j)
+			sink = evaluate(&ctx, &opt);
+		t_opt = now() - start;
+
+		a = evaluate(&ctx, &plain);
+		b = evaluate(&ctx, &opt);
+		printf("%-8d %-8d %-10.1f %-10.1f %-10.1f %-10.1f %-8s %.*s%s\n", 
+		plain.n_code, opt.n_code, t_comp_plain / reps * 1e9, t_comp_opt / reps * 1e9,
+		t_plain / reps * 1e9, t_opt / reps * 1e9, 
+		memcmp(&a, &b, sizeof(a)) == 0 ? "yes" : "no", 40, expr, strlen(expr) > 40 ? "..." : "");
+	}
+	printf("(times are in ns per expression)\n");
+
+	comp_destroy(&opt);
+	comp_destroy(&plain);
+	free(gen);
+	return;
+}
+
+static void bench_par(void)
+{
+	/* sums of small groups, the way generated expressions look; 
+	 * the results on many threads can differ from the one on one thread in the 
+	 * last digits, since the long sum is added up in pieces, but not from each other */
+	static const int threads[] = {2, 4, 8, 16};
+	comp_expr serial, par;
+	const int n_terms = 200000;
+	const int reps = 10;
+	double t_serial, t_comp, t_par, start, a, b, first = 0.0;
+	char * expr;
+	int i, j, len;
+
+	if ( (expr = malloc(n_terms * 32)) == NULL)
+	{
+		fprintf(stderr, "Err: memory allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+	for (i = len = 0; i < n_terms; ++i)
+	{
+		len += sprintf(expr + len, "%s1.0%d*(0.9%d+1.0%d/1.0%d)^2", 
+		(0 == i) ? "" : ((i % 3) ? "+" : "-"), i % 10, (i / 10) % 10, (i / 100) % 10, i % 7);
+	}
+
+	comp_init(&serial);
+	comp_init(&par);
+	ctx.par_threads = 1;
+	start = now();
+	compile(&ctx, &serial, expr);
+	t_comp = now() - start;
+
+	// the first evaluation makes the work buffer grow
+	sink = evaluate(&ctx, &serial);
+	start = now();
+	for (j = 0; j < reps; ++j)
+		sink = evaluate(&ctx, &serial);
+	t_serial = now() - start;
+	a = evaluate(&ctx, &serial);
+
+	printf("par: %d operations, %d repetitions\n", serial.n_code, reps);
+	printf("%-8s %-12s %-8s %-10s %s\n", "threads", "evaluate", "speedup", "compile", "result");
+	printf("%-8d %-12.3f %-8.1f %-10.3f %.17g\n", 1, t_serial / reps * 1e3, 1.0, t_comp * 1e3, a);
+	for (i = 0; i < sizeof(threads) / sizeof(*threads); ++i)
+	{
+		ctx.par_threads = threads[i];
+		start = now();
+		compile(&ctx, &par, expr);
+		t_comp = now() - start;
+
+		// the threads start with the first evaluation
+		sink = evaluate(&ctx, &par);
+		start = now();
+		for (j = 0; j < reps; ++j)
+			sink = evaluate(&ctx, &par);
+		t_par = now() - start;
+		b = evaluate(&ctx, &par);
+		if (0 == i)
+			first = b;
+
+		printf("%-8d %-12.3f %-8.1f %-10.3f %.17g%s\n", threads[i], t_par / reps * 1e3, 
+		t_serial / t_par, t_comp * 1e3, b, 
+		memcmp(&b, &first, sizeof(b)) == 0 ? "" : " (not the same)");
+	}
+	printf("(times are in ms per expression)\n");
+	ctx.par_threads = 1;
+
+	comp_destroy(&par);
+	comp_destroy(&serial);
+	free(expr);
+	return;
+}
+
+static void bench_check(void)
+{
+	/* a valid expression, then the same with an error near the end */
+	static const int threads[] = {2, 4, 8, 16};
+	const int n_terms = 200000;
+	const int reps = 5;
+	double t_serial, t_par, start;
+	char * expr, * a, * b;
+	Context pctx;
+	int i, j, k, len, err_a, err_b, same;
+
+	if ( (expr = malloc(n_terms * 32)) == NULL || (a = malloc(n_terms * 32)) == NULL ||
+		(b = malloc(n_terms * 32)) == NULL)
+	{
+		fprintf(stderr, "Err: memory allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+	for (i = len = 0; i < n_terms; ++i)
+	{
+		len += sprintf(expr + len, "%s1.0%d*-(0.9%d+-1.0%d/x%d)^2", 
+		(0 == i) ? "" : ((i % 3) ? "+" : "-"), i % 10, (i / 10) % 10, (i / 100) % 10, i % 7);
+	}
+
+	context_init(&pctx);
+	printf("check: %d characters, %d repetitions, %s kernel\n", len, reps, scan_kernel());
+	printf("%-8s %-8s %-12s %-8s %s\n", "error", "threads", "check", "speedup", "same");
+	for (k = 0; k < 2; ++k)
+	{
+		if (1 == k)
+			expr[len - len / 50] = '$';
+
+		t_serial = 0.0;
+		for (j = 0; j < reps; ++j)
+		{
+			memcpy(a, expr, len + 1);
+			start = now();
+			errchk(&ctx, a);
+			t_serial += now() - start;
+		}
+		err_a = ctx.err_code;
+		printf("%-8d %-8d %-12.3f %-8.1f %s\n", err_a, 1, t_serial / reps * 1e3, 1.0, "-");
+
+		for (i = 0; i < sizeof(threads) / sizeof(*threads); ++i)
+		{
+			t_par = 0.0;
+			for (j = 0; j < reps; ++j)
+			{
+				memcpy(b, expr, len + 1);
+				start = now();
+				errchk_par(&pctx, b, threads[i]);
+				t_par += now() - start;
+			}
+			err_b = pctx.err_code;
+			same = (err_a == err_b && ctx.err_pos == pctx.err_pos &&
+				ctx.err_char == pctx.err_char && ctx.err_next == pctx.err_next &&
+				ctx.err_list == pctx.err_list && memcmp(a, b, len + 1) == 0);
+			printf("%-8d %-8d %-12.3f %-8.1f %s\n", err_b, threads[i], t_par / reps * 1e3, 
+			t_serial / t_par, same ? "yes" : "no");
+		}
+	}
+	printf("(times are in ms per expression)\n");
+
+	free(b);
+	free(a);
+	free(expr);
+	return;
+}
+
+static void bench_containers(void)
+{
+	/* every round puts n elements in and takes them out */
+	static const int sizes[] = {4, 64, 4096};
+	const long total = 4000000;
+	Pool pool;
+	Queue lq;
+	Stack ls;
+	RQueue rq;
+	VStack vs;
+	void * data;
+	double start, t_lq, t_rq, t_ls, t_vs;
+	long k, rounds, sum_l, sum_a;
+	int i, j, n;
+	bool same;
+
+	pool_init(&pool, sizeof(QueueElmt) > sizeof(StackElmt) ? sizeof(QueueElmt) : sizeof(StackElmt), 256);
+	queue_init_pool(&lq, NULL, &pool);
+	stack_init_pool(&ls, NULL, &pool);
+	rqueue_init(&rq, NULL);
+	vstack_init(&vs, NULL);
+
+	printf("containers: %ld elements in and out per run\n", total);
+	printf("%-8s %-10s %-10s %-10s %-10s %s\n", "size", "queue", "rqueue", "stack", "vstack", "same");
+	for (i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i)
+	{
+		n = sizes[i];
+		rounds = total / n;
+		same = true;
+
+		// the order is checked by weighing every element with its place
+		start = now();
+		for (k = 0, sum_l = 0; k < rounds; ++k)
+		{
+			for (j = 0; j < n; ++j)
+				queue_enq(&lq, (void *)(long)(j + 1));
+			for (j = 0; j < n; ++j)
+			{
+				queue_deq(&lq, &data);
+				sum_l += (long)data * (j + 1);
+			}
+		}
+		t_lq = now() - start;
+
+		start = now();
+		for (k = 0, sum_a = 0; k < rounds; ++k)
+		{
+			for (j = 0; j < n; ++j)
+				rqueue_enq(&rq, (void *)(long)(j + 1));
+			for (j = 0; j < n; ++j)
+			{
+				rqueue_deq(&rq, &data);
+				sum_a += (long)data * (j + 1);
+			}
+		}
+		t_rq = now() - start;
+		same = same && (sum_l == sum_a);
+
+		start = now();
+		for (k = 0, sum_l = 0; k < rounds; ++k)
+		{
+			for (j = 0; j < n; ++j)
+				stack_push(&ls, (void *)(long)(j + 1));
+			for (j = 0; j < n; ++j)
+			{
+				stack_pop(&ls, &data);
+				sum_l += (long)data * (j + 1);
+			}
+		}
+		t_ls = now() - start;
+
+		start = now();
+		for (k = 0, sum_a = 0; k < rounds; ++k)
+		{
+			for (j = 0; j < n; ++j)
+				vstack_push(&vs, (void *)(long)(j + 1));
+			for (j = 0; j < n; ++j)
+			{
+				vstack_pop(&vs, &data);
+				sum_a += (long)data * (j + 1);
+			}
+		}
+		t_vs = now() - start;
+		same = same && (sum_l == sum_a);
+
+		printf("%-8d %-10.2f %-10.2f %-10.2f %-10.2f %s\n", n, t_lq / (rounds * n) * 1e9, 
+		t_rq / (rounds * n) * 1e9, t_ls / (rounds * n) * 1e9, t_vs / (rounds * n) * 1e9, 
+		same ? "yes" : "no");
+	}
+	printf("(times are in ns per element, in and out)\n");
+
+	vstack_destroy(&vs);
+	rqueue_destroy(&rq);
+	stack_destroy(&ls);
+	queue_destroy(&lq);
+	pool_destroy(&pool);
+	return;
+}
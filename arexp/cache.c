@@ -0,0 +1,208 @@
+/* cache.c -- a bounded cache of expression results */
+/* a hash table of entries chained by index; when the table is full, the
+ * CLOCK algorithm picks an entry to reuse: the hand goes around the entries
+ * clearing their reference bits, and stops at the first one which hasn't been
+ * looked up since the hand last passed it */
+
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+
+// marks the end of a chain
+#define NONE	-1
+
+// FNV-1a constants
+#define FNV_BASIS	2166136261UL
+#define FNV_PRIME	16777619UL
+
+// hashes the string at key and sets *len to its length
+static unsigned long hash_str(const char * key, size_t * len);
+
+// finds the entry of key; NONE if it's not there
+static int find(const Cache * cache, const char * key, unsigned long hash);
+
+// picks an entry to reuse and takes it out of its chain
+static int evict(Cache * cache);
+
+/* --------------- MAIN CODE --------------- */
+int cache_init(Cache * cache, int size)
+{
+	/* at most one entry per bucket on average */
+	int i;
+
+	memset(cache, 0, sizeof(*cache));
+	if (size <= 0)
+		return 0;
+
+	cache->n_buckets = 1;
+	while (cache->n_buckets < size)
+		cache->n_buckets *= 2;
+
+	cache->ents = calloc(size, sizeof(*cache->ents));
+	cache->buckets = malloc(cache->n_buckets * sizeof(*cache->buckets));
+	if (NULL == cache->ents || NULL == cache->buckets)
+	{
+		cache_destroy(cache);
+		return -1;
+	}
+
+	for (i = 0; i < cache->n_buckets; ++i)
+		cache->buckets[i] = NONE;
+	cache->size = size;
+
+	return 0;
+}
+
+void cache_destroy(Cache * cache)
+{
+	/* free the keys, then the tables */
+	int i;
+
+	for (i = 0; i < cache->n_ents; ++i)
+		free(cache->ents[i].key);
+	free(cache->ents);
+	free(cache->buckets);
+	memset(cache, 0, sizeof(*cache));
+
+	return;
+}
+
+bool cache_get(Cache * cache, const char * key, double * value)
+{
+	/* a hit marks the entry as recently used */
+	unsigned long hash;
+	size_t len;
+	int i;
+
+	if (0 == cache->size)
+	{
+		++cache->misses;
+		return false;
+	}
+
+	hash = hash_str(key, &len);
+	if ( (i = find(cache, key, hash)) == NONE)
+	{
+		++cache->misses;
+		return false;
+	}
+
+	cache->ents[i].ref = true;
+	*value = cache->ents[i].value;
+	++cache->hits;
+	return true;
+}
+
+int cache_put(Cache * cache, const char * key, double value)
+{
+	/* take a free entry while there are any, reuse one after that */
+	cache_entry * ent;
+	char * new_key;
+	unsigned long hash;
+	size_t len;
+	int i, bucket;
+
+	if (0 == cache->size)
+		return 0;
+
+	hash = hash_str(key, &len);
+	i = (cache->n_ents < cache->size) ? cache->n_ents++ : evict(cache);
+	ent = &cache->ents[i];
+
+	if (ent->key_size < len + 1)
+	{
+		if ( (new_key = realloc(ent->key, len + 1)) == NULL)
+		{
+			// the entry is out of every chain; it stays empty
+			ent->key_size = 0;
+			free(ent->key);
+			ent->key = NULL;
+			ent->ref = false;
+			ent->hash = 0;
+			return -1;
+		}
+		ent->key = new_key;
+		ent->key_size = len + 1;
+	}
+
+	memcpy(ent->key, key, len + 1);
+	ent->hash = hash;
+	ent->value = value;
+	// a new entry has to wait for a lap of the hand before it's a victim
+	ent->ref = true;
+
+	bucket = hash & (cache->n_buckets - 1);
+	ent->next = cache->buckets[bucket];
+	cache->buckets[bucket] = i;
+
+	return 0;
+}
+
+void cache_print(FILE * stream, const Cache * cache)
+{
+	/* the hit rate only when there were lookups */
+	long lookups = cache->hits + cache->misses;
+
+	fprintf(stream, "cache: %ld hits, %ld misses", cache->hits, cache->misses);
+	if (lookups > 0)
+		fprintf(stream, ", %.1f%% hit rate", 100.0 * cache->hits / lookups);
+	fprintf(stream, "; %d of %d entries used\n", cache->n_ents, cache->size);
+	return;
+}
+
+static unsigned long hash_str(const char * key, size_t * len)
+{
+	/* FNV-1a, cut to 32 bits on every machine */
+	const unsigned char * p = (const unsigned char *)key;
+	unsigned long hash = FNV_BASIS;
+
+	for ( ; *p != '\0'; ++p)
+		hash = ((hash ^ *p) * FNV_PRIME) & 0xFFFFFFFFUL;
+
+	*len = (const char *)p - key;
+	return hash;
+}
+
+static int find(const Cache * cache, const char * key, unsigned long hash)
+{
+	/* compare the strings only when the hashes agree */
+	const cache_entry * ent;
+	int i;
+
+	for (i = cache->buckets[hash & (cache->n_buckets - 1)]; i != NONE; i = ent->next)
+	{
+		ent = &cache->ents[i];
+		if (ent->hash == hash && strcmp(ent->key, key) == 0)
+			return i;
+	}
+
+	return NONE;
+}
+
+static int evict(Cache * cache)
+{
+	/* go around clearing the reference bits; the whole cache can't be
+	 * referenced after one lap, so this stops */
+	cache_entry * ent;
+	int victim, * link;
+
+	while (cache->ents[cache->hand].ref)
+	{
+		cache->ents[cache->hand].ref = false;
+		cache->hand = (cache->hand + 1) % cache->size;
+	}
+	victim = cache->hand;
+	cache->hand = (cache->hand + 1) % cache->size;
+
+	// an entry whose key couldn't be saved is in no chain
+	ent = &cache->ents[victim];
+	if (NULL == ent->key)
+		return victim;
+
+	link = &cache->buckets[ent->hash & (cache->n_buckets - 1)];
+	while (*link != victim)
+		link = &cache->ents[*link].next;
+	*link = ent->next;
+
+	return victim;
+}
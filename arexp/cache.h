@@ -0,0 +1,86 @@
+/* cache.h -- interface for cache.c */
+
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* structure for an entry
+ * key is key_size bytes big, so it's kept when the entry is reused;
+ * next links the entries of a bucket, -1 ends the chain;
+ * ref is the reference bit of the CLOCK eviction */
+typedef struct cache_entry_ {
+	char * key;
+	size_t key_size;
+	unsigned long hash;
+	double value;
+	int next;
+	bool ref;
+} cache_entry;
+
+/* structure for the cache */
+typedef struct Cache_ {
+	cache_entry * ents;
+	int * buckets;
+	int size;
+	int n_buckets;
+	int n_ents;
+	int hand;
+	long hits;
+	long misses;
+} Cache;
+
+/* public interface */
+int cache_init(Cache * cache, int size);
+/*
+returns: 0 on success, -1 on failure
+
+description: Initializes cache for at most size results. A cache of size 0 
+keeps nothing and every lookup is a miss. On failure cache is the same as 
+one of size 0.
+
+complexity: O(n)
+*/
+
+void cache_destroy(Cache * cache);
+/*
+returns: nothing
+
+description: Frees the memory held by cache. cache can be used again only 
+after another call to cache_init().
+
+complexity: O(n)
+*/
+
+bool cache_get(Cache * cache, const char * key, double * value);
+/*
+returns: true and the result in *value if key is in cache, false otherwise
+
+description: Looks up the result of the expression key, which is compared as 
+it is, so it must already be normalized. Counts a hit or a miss.
+
+complexity: O(1) on average
+*/
+
+int cache_put(Cache * cache, const char * key, double value);
+/*
+returns: 0 on success, -1 if there's no memory for the key
+
+description: Saves value as the result of key. When cache is full, the least 
+recently used entry, as far as the CLOCK algorithm can tell, makes room. 
+key must not be in cache already.
+
+complexity: O(1) amortized
+*/
+
+void cache_print(FILE * stream, const Cache * cache);
+/*
+returns: nothing
+
+description: Prints the hits, misses, and size of cache on stream.
+
+complexity: O(1)
+*/
+#endif
@@ -0,0 +1,353 @@
+/* cells.c -- named cells with formulas, recomputed as they change */
+/* every cell holds its formula compiled, with the variables bound to the
+ * values of the cells they name; the cells form a graph, with an edge from
+ * every cell to the cells whose formulas read it; setting a formula looks for
+ * every cell reachable from the cell by going depth first, and the reverse of
+ * the order in which they are finished is an order in which each cell comes
+ * after the cells it reads; the same walk finds cycles, since a formula which
+ * reads a cell reachable from its own would close one */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "errchk.h"
+#include "cells.h"
+
+// marks an index which isn't there
+#define NONE	-1
+
+// finds the cell or makes one without a formula; NONE on failure
+static int find_or_add(Sheet * sheet, const char * name, int len);
+
+// frees the cells made since there were n_cells, which nothing refers to
+static void drop_cells(Sheet * sheet, int n_cells);
+
+// frees a cell
+static void free_cell(cell * c);
+
+// puts the cells reachable from cell from in sheet->order, in the order
+// they're to be recomputed
+static void collect(Sheet * sheet, int from);
+
+// makes sure sheet has room for one more cell
+static int sheet_reserve(Sheet * sheet);
+
+// adds user to the users of cell c
+static int add_user(cell * c, int user);
+
+// removes user from the users of cell c
+static void remove_user(cell * c, int user);
+
+/* --------------- MAIN CODE --------------- */
+void sheet_init(Sheet * sheet)
+{
+	/* no cells until the first sheet_set() */
+	memset(sheet, 0, sizeof(*sheet));
+	comp_init(&sheet->scratch);
+	return;
+}
+
+void sheet_destroy(Sheet * sheet)
+{
+	/* the cells, then the sheet */
+	drop_cells(sheet, 0);
+	comp_destroy(&sheet->scratch);
+	free(sheet->cells);
+	free(sheet->order);
+	free(sheet->stack);
+	free(sheet->stack_pos);
+	memset(sheet, 0, sizeof(*sheet));
+	return;
+}
+
+int sheet_find(const Sheet * sheet, const char * name, int len)
+{
+	/* a sheet is a few hundred cells at most */
+	const char * cn;
+	int i;
+
+	for (i = 0; i < sheet->n_cells; ++i)
+	{
+		cn = sheet->cells[i]->name;
+		if (strncmp(cn, name, len) == 0 && '\0' == cn[len])
+			return i;
+	}
+
+	return NONE;
+}
+
+int sheet_set(Sheet * sheet, Context * ctx, const char * name, int len, const char * formula)
+{
+	/* compile aside, check for cycles, relink, and recompute; the cells
+	 * made on the way are dropped again on error */
+	comp_expr tmp;
+	cell * c;
+	char * text;
+	int i, j, idx, dep, * deps, n_cells = sheet->n_cells;
+	
+	if (compile(ctx, &sheet->scratch, formula) != ERR_NONE)
+		return ctx->err_code;
+	
+	deps = NULL;
+	text = NULL;
+	if ( (idx = find_or_add(sheet, name, len)) == NONE ||
+		(sheet->scratch.n_vars > 0 && 
+		(deps = malloc(sheet->scratch.n_vars * sizeof(*deps))) == NULL) ||
+		(text = malloc(strlen(formula) + 1)) == NULL)
+		goto no_memory;
+	
+	for (i = 0; i < sheet->scratch.n_vars; ++i)
+	{
+		if ( (deps[i] = find_or_add(sheet, sheet->scratch.vars[i].name, 
+			strlen(sheet->scratch.vars[i].name))) == NONE)
+			goto no_memory;
+	}
+	
+	// the cells which depend on this one are the ones to recompute, and none
+	// of them can be read by the new formula
+	collect(sheet, idx);
+	for (i = 0; i < sheet->scratch.n_vars; ++i)
+	{
+		if (sheet->cells[deps[i]]->mark == sheet->mark)
+		{
+			free(deps);
+			free(text);
+			drop_cells(sheet, n_cells);
+			return SHEET_CYCLE;
+		}
+	}
+	
+	// the new dependences first, so nothing has changed if there's no memory
+	for (i = 0; i < sheet->scratch.n_vars; ++i)
+	{
+		if (add_user(sheet->cells[deps[i]], idx) != 0)
+		{
+			for (j = 0; j < i; ++j)
+				remove_user(sheet->cells[deps[j]], idx);
+			goto no_memory;
+		}
+	}
+	
+	// a cell read by both formulas is left with one entry
+	c = sheet->cells[idx];
+	for (i = 0; i < c->n_deps; ++i)
+		remove_user(sheet->cells[c->deps[i]], idx);
+	
+	free(c->deps);
+	c->deps = deps;
+	c->n_deps = sheet->scratch.n_vars;
+	free(c->formula);
+	c->formula = text;
+	strcpy(c->formula, formula);
+	c->defined = true;
+	
+	// the old compiled formula is compiled over next time
+	tmp = c->cexp;
+	c->cexp = sheet->scratch;
+	sheet->scratch = tmp;
+	for (i = 0; i < c->n_deps; ++i)
+		comp_bind(&c->cexp, c->cexp.vars[i].name, &sheet->cells[c->deps[i]]->value);
+	
+	for (i = 0; i < sheet->n_order; ++i)
+	{
+		dep = sheet->order[i];
+		sheet->cells[dep]->value = evaluate(ctx, &sheet->cells[dep]->cexp);
+	}
+	
+	return ERR_NONE;
+
+no_memory:
+	free(deps);
+	free(text);
+	drop_cells(sheet, n_cells);
+	errchk_start(ctx);
+	return err_set(ctx, ERR_MEMORY, 0);
+}
+
+const char * sheet_undefined(const Sheet * sheet, int i)
+{
+	/* in the order of the formula */
+	const cell * c = sheet->cells[i];
+	int j;
+
+	for (j = 0; j < c->n_deps; ++j)
+	{
+		if (!sheet->cells[c->deps[j]]->defined)
+			return sheet->cells[c->deps[j]]->name;
+	}
+
+	return NULL;
+}
+
+void sheet_bind(const Sheet * sheet, comp_expr * cexp)
+{
+	/* the cells without a formula stay unbound */
+	int i, j;
+
+	for (i = 0; i < cexp->n_vars; ++i)
+	{
+		j = sheet_find(sheet, cexp->vars[i].name, strlen(cexp->vars[i].name));
+		if (j != NONE && sheet->cells[j]->defined)
+			comp_bind(cexp, cexp->vars[i].name, &sheet->cells[j]->value);
+	}
+
+	return;
+}
+
+static int find_or_add(Sheet * sheet, const char * name, int len)
+{
+	/* a new cell has no value until it has a formula */
+	cell * c;
+	int i;
+
+	if ( (i = sheet_find(sheet, name, len)) != NONE)
+		return i;
+
+	if (sheet_reserve(sheet) != 0 || (c = calloc(1, sizeof(*c))) == NULL)
+		return NONE;
+	if ( (c->name = malloc(len + 1)) == NULL)
+	{
+		free(c);
+		return NONE;
+	}
+
+	memcpy(c->name, name, len);
+	c->name[len] = '\0';
+	comp_init(&c->cexp);
+	c->value = NAN;
+	c->mark = sheet->mark;
+	
+	sheet->cells[sheet->n_cells] = c;
+	return sheet->n_cells++;
+}
+
+static void drop_cells(Sheet * sheet, int n_cells)
+{
+	/* the last ones first */
+	while (sheet->n_cells > n_cells)
+		free_cell(sheet->cells[--sheet->n_cells]);
+	return;
+}
+
+static void free_cell(cell * c)
+{
+	/* and everything it owns */
+	comp_destroy(&c->cexp);
+	free(c->name);
+	free(c->formula);
+	free(c->deps);
+	free(c->users);
+	free(c);
+	return;
+}
+
+static void collect(Sheet * sheet, int from)
+{
+	/* depth first, without recursion, since chains of cells can be long;
+	 * the graph has no cycles, so a cell is finished after all of its users */
+	int top, c, u, i, tmp;
+	cell * cl;
+
+	++sheet->mark;
+	sheet->n_order = 0;
+	sheet->cells[from]->mark = sheet->mark;
+	sheet->stack[0] = from;
+	sheet->stack_pos[0] = 0;
+	top = 1;
+
+	while (top > 0)
+	{
+		c = sheet->stack[top - 1];
+		cl = sheet->cells[c];
+		if (sheet->stack_pos[top - 1] < cl->n_users)
+		{
+			u = cl->users[sheet->stack_pos[top - 1]++];
+			if (sheet->cells[u]->mark != sheet->mark)
+			{
+				sheet->cells[u]->mark = sheet->mark;
+				sheet->stack[top] = u;
+				sheet->stack_pos[top] = 0;
+				++top;
+			}
+		}
+		else
+		{
+			sheet->order[sheet->n_order++] = c;
+			--top;
+		}
+	}
+
+	// finished last comes first
+	for (i = 0; i < sheet->n_order / 2; ++i)
+	{
+		tmp = sheet->order[i];
+		sheet->order[i] = sheet->order[sheet->n_order - 1 - i];
+		sheet->order[sheet->n_order - 1 - i] = tmp;
+	}
+
+	return;
+}
+
+static int sheet_reserve(Sheet * sheet)
+{
+	/* grow to double the size; a walk can't have more cells than the sheet */
+	cell ** new_cells;
+	int * new_order, * new_stack, * new_pos;
+	int new_size;
+
+	if (sheet->n_cells < sheet->size)
+		return 0;
+
+	new_size = sheet->size ? sheet->size * 2 : 16;
+	if ( (new_cells = realloc(sheet->cells, new_size * sizeof(*new_cells))) == NULL)
+		return -1;
+	sheet->cells = new_cells;
+	if ( (new_order = realloc(sheet->order, new_size * sizeof(*new_order))) == NULL)
+		return -1;
+	sheet->order = new_order;
+	if ( (new_stack = realloc(sheet->stack, new_size * sizeof(*new_stack))) == NULL)
+		return -1;
+	sheet->stack = new_stack;
+	if ( (new_pos = realloc(sheet->stack_pos, new_size * sizeof(*new_pos))) == NULL)
+		return -1;
+	sheet->stack_pos = new_pos;
+
+	sheet->size = new_size;
+	return 0;
+}
+
+static int add_user(cell * c, int user)
+{
+	/* at the end */
+	int * new_users;
+	int new_size;
+
+	if (c->n_users == c->users_size)
+	{
+		new_size = c->users_size ? c->users_size * 2 : 4;
+		if ( (new_users = realloc(c->users, new_size * sizeof(*new_users))) == NULL)
+			return -1;
+		c->users = new_users;
+		c->users_size = new_size;
+	}
+
+	c->users[c->n_users++] = user;
+	return 0;
+}
+
+static void remove_user(cell * c, int user)
+{
+	/* one of them; the order doesn't matter */
+	int i;
+
+	for (i = 0; i < c->n_users; ++i)
+	{
+		if (c->users[i] == user)
+		{
+			c->users[i] = c->users[--c->n_users];
+			return;
+		}
+	}
+
+	return;
+}
@@ -0,0 +1,105 @@
+/* cells.h -- interface for cells.c */
+
+#ifndef CELLS_H_
+#define CELLS_H_
+
+#include <stdbool.h>
+#include "context.h"
+#include "eval.h"
+
+// returned by sheet_set() for a formula which would depend on its own cell
+#define SHEET_CYCLE	-1
+
+/* structure for a cell
+ * a cell which is used before it's given a formula is not defined, and its
+ * value is NAN; deps are the cells the formula reads, users are the cells whose
+ * formulas read this one; mark is for going through the graph */
+typedef struct cell_ {
+	char * name;
+	char * formula;
+	comp_expr cexp;
+	double value;
+	bool defined;
+	int * deps;
+	int n_deps;
+	int * users;
+	int n_users;
+	int users_size;
+	int mark;
+} cell;
+
+/* structure for the sheet
+ * the cells are allocated one by one, so the values their formulas are bound
+ * to never move; order lists the cells recomputed by the last sheet_set() */
+typedef struct Sheet_ {
+	cell ** cells;
+	int n_cells;
+	int size;
+	int * order;
+	int n_order;
+	int * stack;
+	int * stack_pos;
+	int mark;
+	comp_expr scratch;
+} Sheet;
+
+/* public interface */
+void sheet_init(Sheet * sheet);
+/*
+returns: nothing
+
+description: Initializes sheet with no cells. Must be called before sheet can be used.
+
+complexity: O(1)
+*/
+
+void sheet_destroy(Sheet * sheet);
+/*
+returns: nothing
+
+description: Frees the memory held by sheet. No other operations are permitted after
+calling sheet_destroy.
+
+complexity: O(n)
+*/
+
+int sheet_find(const Sheet * sheet, const char * name, int len);
+/*
+returns: the index of the cell called by the len characters at name, -1 if 
+there's no such cell
+
+complexity: O(n)
+*/
+
+int sheet_set(Sheet * sheet, Context * ctx, const char * name, int len, const char * formula);
+/*
+returns: ERR_NONE on success, an error code of compile() if formula is not
+valid, SHEET_CYCLE if the cell would depend on itself
+
+description: Gives the cell called by the len characters at name the formula,
+making the cell if there isn't one. The names in formula are cells; the ones
+which don't exist yet are made, without a formula. Then the cell and every cell 
+which depends on it, directly or not, are evaluated in an order where a cell 
+comes after all the cells it depends on, and nothing else is; the indexes of 
+the cells are left in sheet->order in that order. On error, nothing changes.
+
+complexity: O(n + e), where n and e are the cells and the dependences recomputed
+*/
+
+const char * sheet_undefined(const Sheet * sheet, int i);
+/*
+returns: the name of the first cell the formula of cell i reads which has no
+formula, NULL if there's none
+*/
+
+void sheet_bind(const Sheet * sheet, comp_expr * cexp);
+/*
+returns: nothing
+
+description: Binds the variables of cexp to the values of the cells of the same
+name which have a formula, so an expression can use the cells without becoming
+one.
+
+complexity: O(n * m), where m is the number of variables of cexp
+*/
+#endif
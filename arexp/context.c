@@ -0,0 +1,78 @@
+/* context.c -- initialization of the engine state */
+
+#include <stdlib.h>
+#include <string.h> // for memset()
+#include "context.h"
+#include "eval.h"
+#include "opt.h"
+#include "par.h"
+
+// blocks per chunk of the pool
+#define POOL_CHUNK	256
+
+// operator records used by eval.c are no larger than two ints; 
+// the queues and stacks they wait in keep their elements in arrays
+#define POOL_BLOCK	(2 * sizeof(int))
+
+void context_init(Context * ctx)
+{
+	/* initialize the context */
+	memset(ctx, 0, sizeof(*ctx));
+	ctx->verbose = true;
+	ctx->f_prec = DEF_PREC;
+	ctx->par_threads = 1;
+	ctx->max_depth = DEF_MAX_DEPTH;
+	pool_init(&ctx->pool, POOL_BLOCK, POOL_CHUNK);
+	
+	return;
+}
+
+int context_reserve(Context * ctx, int n_nums)
+{
+	/* grow to at least double the size */
+	int * new_link;
+	double * new_work;
+	int new_size;
+	
+	if (n_nums <= ctx->nums_size)
+		return 0;
+	
+	new_size = ctx->nums_size * 2;
+	if (new_size < n_nums)
+		new_size = n_nums;
+	
+	if ( (new_link = realloc(ctx->num_link, new_size * sizeof(*new_link))) == NULL)
+		return -1;
+	ctx->num_link = new_link;
+	
+	if ( (new_work = realloc(ctx->work, new_size * sizeof(*new_work))) == NULL)
+		return -1;
+	ctx->work = new_work;
+	
+	ctx->nums_size = new_size;
+	return 0;
+}
+
+void context_destroy(Context * ctx)
+{
+	/* free the buffers and the pool */
+	free(ctx->num_link);
+	free(ctx->work);
+	compile_destroy(ctx);
+	free(ctx->rows);
+	free(ctx->steps);
+	free(ctx->trace_text);
+	free(ctx->pratt_ops);
+	if (ctx->calc_cexp != NULL)
+	{
+		comp_destroy(ctx->calc_cexp);
+		free(ctx->calc_cexp);
+	}
+	opt_destroy(ctx);
+	par_destroy(ctx);
+	pool_destroy(&ctx->pool);
+	// zero out memory of the structure
+	memset(ctx, 0, sizeof(*ctx));
+	
+	return;
+}
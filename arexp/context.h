@@ -0,0 +1,167 @@
+/* context.h -- the state of one instance of the engine */
+
+#ifndef CONTEXT_H_
+#define CONTEXT_H_
+
+#include <stdbool.h>
+#include "pool.h"
+
+// default decimal precision of the printed operations
+#define DEF_PREC		2
+
+// default deepest nesting of parentheses compile() takes
+#define DEF_MAX_DEPTH	(1 << 16)
+
+// big enough for any message made by err_format()
+#define ERR_MSG_SIZE	256
+
+/* error codes left in ctx->err_code */
+enum {
+	ERR_NONE = 0,
+	ERR_INVALID_CHAR,	// not a digit, a name, an operator, or a parenthesis
+	ERR_BAD_START,		// an operator which can't begin an expression
+	ERR_EXPECTED,		// the character after err_char is not in err_list
+	ERR_UNEXPECTED,		// same, but the operand is what's wrong, not the operator
+	ERR_UNFINISHED,		// err_char can't be the last character
+	ERR_PARENS,			// unmatched parentheses
+	ERR_NO_NUMBERS,		// nothing to compute
+	ERR_DEPTH,			// parentheses nested deeper than max_depth
+	ERR_MEMORY			// an allocation failed
+};
+
+/* engines used by calculate() */
+enum {
+	ENGINE_QUEUES = 0,	// compile() and evaluate()
+	ENGINE_PRATT		// pratt_calc(), in a single pass
+};
+
+/* structure for a step of the trace */
+typedef struct trace_step_ {
+	double lhs;
+	double rhs;
+	double result;
+	int op;
+} trace_step;
+
+/* structure for the statistics
+ * counts of what compile() and evaluate() have done, and the time it took */
+typedef struct ctx_stats_ {
+	long exprs;
+	long errors;
+	long evals;
+	long numbers;
+	long operators;
+	long heap_calls;
+	int peak_nums;
+	double t_compile;
+	double t_eval;
+} ctx_stats;
+
+/* structure for the context
+ * everything errchk.c and eval.c need in order to check, compile and evaluate
+ * an expression lives here, so every thread can have its own engine */
+typedef struct Context_ {
+	// settings
+	// with optimize on, compile() optimizes the operations
+	// with jit on, compile() makes native code for evaluate() when it can
+	// with keep_stats on, compile() and evaluate() keep count in stats
+	// with par_threads above 1, evaluate() does huge expressions on that many threads
+	// max_depth is the deepest nesting of parentheses compile() takes, 0 for any
+	// engine is the one calculate() uses; ENGINE_PRATT is left for compile()
+	// while verbose or keep_stats is on, or when there are names
+	bool verbose;
+	bool optimize;
+	bool jit;
+	bool keep_stats;
+	int f_prec;
+	int par_threads;
+	int max_depth;
+	int engine;
+	ctx_stats stats;
+	
+	// error checking
+	// nothing is printed; the first error of an expression is described here,
+	// err_pos is its offset in the expression, err_char and err_next are the 
+	// characters it's about, and err_list is what was expected instead
+	int err_code;
+	int err_pos;
+	int err_char;
+	int err_next;
+	const char * err_list;
+	
+	// compiling
+	// num_link and work have room for nums_size numbers
+	// frames has the operators of the open parentheses, room for frames_size
+	// heap_calls counts the times frames, its queues and its stacks grew
+	const char * expr;
+	const char * buff_ptr;
+	const char * buff_end;
+	int par_count;
+	struct comp_expr_ * curr_cexp;
+	int nb_count;
+	int nums_size;
+	int * num_link;
+	struct parse_frame_ * frames;
+	int frames_size;
+	long heap_calls;
+	Pool pool;
+	
+	// the work space of optimize()
+	struct opt_scratch_ * opt;
+	
+	// evaluation
+	// rows is the block of rows used by evaluate_rows(), rows_size doubles big
+	// par is the pool of threads used for huge expressions
+	double * work;
+	double * rows;
+	long rows_size;
+	struct par_pool_ * par;
+	
+	// tracing
+	// with verbose on, evaluate() records the steps in steps and prints them
+	// from trace_text, which is trace_size bytes big, when it's done
+	trace_step * steps;
+	int steps_size;
+	char * trace_text;
+	size_t trace_size;
+	
+	// the compiled expression used by calculate()
+	// pratt_ops is the operator stack of pratt_calc(), pratt_size bytes big
+	struct comp_expr_ * calc_cexp;
+	char * pratt_ops;
+	int pratt_size;
+} Context;
+
+/* public interface */
+void context_init(Context * ctx);
+/* 
+returns: nothing
+
+description: Initializes the context specified by ctx. Must be called before ctx can be used. 
+verbose is on, optimize, jit, and keep_stats are off, f_prec is DEF_PREC, par_threads
+is 1, max_depth is DEF_MAX_DEPTH, and engine is ENGINE_QUEUES after the call.
+
+complexity: O(1) 
+*/
+
+int context_reserve(Context * ctx, int n_nums);
+/*
+returns: 0 on success, -1 on failure
+
+description: Makes sure the buffers of ctx have room for at least n_nums numbers. 
+The buffers grow geometrically and never shrink.
+
+complexity: O(n)
+*/
+
+void context_destroy(Context * ctx);
+/*
+returns: nothing
+
+description: Frees the memory held by ctx. No other operations are permitted after calling 
+context_destroy.
+
+complexity: O(n)
+*/
+
+#endif
@@ -0,0 +1,263 @@
+/* corpus.c -- generates random valid expressions */
+/* works by writing a sequence of operands joined by operators from the mix;
+ * an operand is a number, or, while the nesting allows it, a parenthesized
+ * sequence which takes some of the operands of the one around it;
+ * a unary minus can come before any operand, which is valid after
+ * an operator, a '(' or at the start; the exponent after a '^' is kept
+ * small, so the results are mostly finite */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "corpus.h"
+
+// the longest number in characters
+#define MAX_NUM_LEN		12
+
+// one in PAREN_ODDS operands is a parenthesized sequence
+#define PAREN_ODDS		4
+
+// the generator state
+typedef struct gen_ {
+	const corpus_opts * opts;
+	uint64_t state;
+	char * text;
+	size_t len;
+	size_t size;
+	int n_unary;
+	int n_binary;
+} gen;
+
+// the next random number; xorshift64*
+static uint64_t next_rand(gen * g);
+
+// a random number in [0, n)
+static int rand_below(gen * g, int n);
+
+// writes a sequence of n_operands operands
+static void put_seq(gen * g, int n_operands, int depth);
+
+// writes a number; a small one if small is set
+static void put_number(gen * g, int small);
+
+// writes a character
+static void put_char(gen * g, int ch);
+
+// reads a positive number from the option at arg
+static int read_num(const char * arg, long * num);
+
+/* --------------- MAIN CODE --------------- */
+void corpus_defaults(corpus_opts * opts)
+{
+	/* see corpus.h */
+	opts->n_exprs = CORPUS_EXPRS;
+	opts->n_operands = CORPUS_OPERANDS;
+	opts->max_depth = CORPUS_DEPTH;
+	opts->mix = CORPUS_MIX;
+	opts->seed = CORPUS_SEED;
+	return;
+}
+
+int corpus_arg(corpus_opts * opts, const char * arg)
+{
+	/* -<letter><value> */
+	long num;
+
+	if (arg[0] != '-' || '\0' == arg[1])
+		return 0;
+
+	switch (arg[1])
+	{
+		case 'n':
+			if (read_num(arg + 2, &num) != 0)
+				return -1;
+			opts->n_exprs = num;
+			break;
+		case 'l':
+			if (read_num(arg + 2, &num) != 0)
+				return -1;
+			opts->n_operands = num;
+			break;
+		case 'd':
+			if ('0' == arg[2] && '\0' == arg[3])
+				num = 0;
+			else if (read_num(arg + 2, &num) != 0)
+				return -1;
+			opts->max_depth = num;
+			break;
+		case 'm':
+			// at least one binary operator, nothing but operators
+			if (strspn(arg + 2, "+-*/^u") != strlen(arg + 2) ||
+				strspn(arg + 2, "u") == strlen(arg + 2))
+				return -1;
+			opts->mix = arg + 2;
+			break;
+		case 's':
+			if (read_num(arg + 2, &num) != 0)
+				return -1;
+			opts->seed = num;
+			break;
+		default:
+			return 0;
+			break;
+	}
+
+	return 1;
+}
+
+void corpus_usage(void)
+{
+	/* see corpus.h */
+	printf("-n<number>\t- number of expressions, %d by default\n", CORPUS_EXPRS);
+	printf("-l<number>\t- operands per expression, %d by default\n", CORPUS_OPERANDS);
+	printf("-d<number>\t- deepest nesting of parentheses, %d by default\n", CORPUS_DEPTH);
+	printf("-m<ops>\t\t- operators to choose from, u is unary minus; repeat one to make\n");
+	printf("\t\t  it more likely; %s by default\n", CORPUS_MIX);
+	printf("-s<number>\t- random seed, %d by default\n", CORPUS_SEED);
+	return;
+}
+
+char * corpus_make(const corpus_opts * opts, size_t * len)
+{
+	/* one expression per line */
+	const char * op;
+	gen g;
+	int i;
+
+	g.opts = opts;
+	// the state must not be zero
+	g.state = ((uint64_t)opts->seed << 1) | 1;
+	g.text = NULL;
+	g.len = g.size = 0;
+	g.n_unary = g.n_binary = 0;
+	for (op = opts->mix; *op != '\0'; ++op)
+	{
+		if ('u' == *op)
+			++g.n_unary;
+		else
+			++g.n_binary;
+	}
+
+	for (i = 0; i < opts->n_exprs; ++i)
+	{
+		put_seq(&g, opts->n_operands, 0);
+		put_char(&g, '\n');
+	}
+	put_char(&g, '\0');
+
+	*len = g.len - 1;
+	return g.text;
+}
+
+static void put_seq(gen * g, int n_operands, int depth)
+{
+	/* operand (op operand)* */
+	int i, take, op, small = 0;
+
+	for (i = 0; i < n_operands; i += take)
+	{
+		if (i > 0)
+		{
+			// pick a binary operator by its weight
+			do
+				op = g->opts->mix[rand_below(g, strlen(g->opts->mix))];
+			while ('u' == op);
+			put_char(g, op);
+			small = ('^' == op);
+		}
+
+		if (g->n_unary > 0 && rand_below(g, g->n_unary + g->n_binary) < g->n_unary)
+			put_char(g, '-');
+
+		take = 1;
+		if (depth < g->opts->max_depth && n_operands - i > 1 && 0 == rand_below(g, PAREN_ODDS))
+		{
+			take = 1 + rand_below(g, n_operands - i);
+			put_char(g, '(');
+			put_seq(g, take, depth + 1);
+			put_char(g, ')');
+		}
+		else
+			put_number(g, small);
+	}
+
+	return;
+}
+
+static void put_number(gen * g, int small)
+{
+	/* digits with a fractional part half of the time */
+	int i, n;
+
+	if (small)
+	{
+		put_char(g, '0' + rand_below(g, 4));
+		return;
+	}
+
+	n = 1 + rand_below(g, MAX_NUM_LEN / 2);
+	for (i = 0; i < n; ++i)
+		put_char(g, '0' + rand_below(g, 10));
+
+	if (rand_below(g, 2))
+	{
+		put_char(g, '.');
+		n = 1 + rand_below(g, MAX_NUM_LEN / 2 - 1);
+		for (i = 0; i < n; ++i)
+			put_char(g, '0' + rand_below(g, 10));
+	}
+
+	return;
+}
+
+static void put_char(gen * g, int ch)
+{
+	/* grow geometrically */
+	char * new_text;
+	size_t new_size;
+
+	if (g->len == g->size)
+	{
+		new_size = g->size ? g->size * 2 : 4096;
+		if ( (new_text = realloc(g->text, new_size)) == NULL)
+		{
+			fprintf(stderr, "Err: memory allocation failed\n");
+			exit(EXIT_FAILURE);
+		}
+		g->text = new_text;
+		g->size = new_size;
+	}
+
+	g->text[g->len++] = ch;
+	return;
+}
+
+static uint64_t next_rand(gen * g)
+{
+	/* the same sequence everywhere */
+	g->state ^= g->state >> 12;
+	g->state ^= g->state << 25;
+	g->state ^= g->state >> 27;
+	return g->state * 0x2545F4914F6CDD1DULL;
+}
+
+static int rand_below(gen * g, int n)
+{
+	/* the high bits are the best */
+	return (int)((next_rand(g) >> 33) % n);
+}
+
+static int read_num(const char * arg, long * num)
+{
+	/* digits only, greater than zero */
+	char * end;
+
+	if (*arg < '0' || *arg > '9')
+		return -1;
+	*num = strtol(arg, &end, 10);
+	if (*end != '\0' || *num <= 0 || *num > 100000000)
+		return -1;
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+/* corpus.h -- interface for corpus.c */
+
+#ifndef CORPUS_H_
+#define CORPUS_H_
+
+#include <stddef.h>
+
+// default values
+#define CORPUS_EXPRS	10000
+#define CORPUS_OPERANDS	16
+#define CORPUS_DEPTH	3
+#define CORPUS_MIX		"++--**//^u"
+#define CORPUS_SEED		1
+
+/* structure for the corpus options
+ * n_operands is the number of operands of every expression, counting
+ * those inside parentheses; max_depth is the deepest nesting of parentheses;
+ * mix lists the operators to choose from, more copies of one make it more
+ * likely, and 'u' stands for unary minus in front of an operand */
+typedef struct corpus_opts_ {
+	int n_exprs;
+	int n_operands;
+	int max_depth;
+	const char * mix;
+	unsigned long seed;
+} corpus_opts;
+
+/* public interface */
+void corpus_defaults(corpus_opts * opts);
+/*
+returns: nothing
+
+description: Sets opts to the default values above.
+
+complexity: O(1)
+*/
+
+int corpus_arg(corpus_opts * opts, const char * arg);
+/*
+returns: 1 if arg is a corpus option, 0 if it isn't, -1 if it is
+but its value is not valid
+
+description: Reads one of these options in opts:
+-n<number>	- number of expressions
+-l<number>	- number of operands per expression
+-d<number>	- deepest nesting of parentheses
+-m<ops>		- operator mix
+-s<number>	- random seed
+
+complexity: O(1)
+*/
+
+void corpus_usage(void);
+/*
+returns: nothing
+
+description: Prints the options read by corpus_arg() on stdout.
+
+complexity: O(1)
+*/
+
+char * corpus_make(const corpus_opts * opts, size_t * len);
+/*
+returns: a pointer to the corpus, which the caller must free()
+
+description: Generates opts->n_exprs valid expressions, one per line, and sets
+*len to the length of the text. The same options always give the same corpus,
+on any machine, since the random numbers are made here.
+
+complexity: O(n)
+*/
+#endif
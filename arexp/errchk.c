@@ -1,191 +1,306 @@
 /* errchk.c -- infix arithmetic expression error checking */
 /* works by looking at the next character and determines 
  * if it's expected or not
- * also, translates unary operators to internal representation */
+ * also, translates unary operators to internal representation;
+ * which characters can follow which is kept in a table of transitions
+ * between states over classes of characters, so a character costs a lookup;
+ * errchk_tok() checks a single token, so a parser can check as it goes;
+ * nothing is printed; the first error is saved in the context, along with
+ * what's needed to make a message out of it later, by err_format() */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include "errchk.h"
 
-#define ERR_RETURN {err_code = 1; return err_code;}
+#define ERR_RETURN(code, pos, ch, next, list) \
+	return report(ctx, (code), (pos), (ch), (next), (list))
 
-static int err_code;
+// the classes of characters
+enum {
+	C_OTHER,	// can't be in an expression
+	C_DIGIT,
+	C_DOT,
+	C_NAME,		// a letter or _
+	C_OPEN,
+	C_CLOSE,
+	C_PLUS,
+	C_MINUS,
+	C_OP,		// ^ * /
+	C_NUL,		// a '\0' before the end, which only errchk_tok() can see
+	N_CLASSES
+};
 
-// see if the next character in the expression is correct
-static int expect(const char * buff, const char * curr, const char * list);
+// the states of the checker; each is the kind of the last character read
+enum {
+	S_START,	// nothing read yet
+	S_OPEN,
+	S_CLOSE,
+	S_OP,		// ^ * /
+	S_SIGN,		// a binary + or -
+	S_UPLUS,
+	S_UMINUS,
+	S_DIGIT,
+	S_DOT,
+	S_NAME,
+	N_STATES,
+	// what's wrong with a character which has no state to go to
+	X_NEXT = N_STATES,	// it can't follow the one before, see next_code and next_list
+	X_START,			// it can't begin an expression
+	X_CHAR				// it's not valid anywhere
+};
+
+// the class of every character
+static const unsigned char char_class[256] = {
+	['\0'] = C_NUL, ['.'] = C_DOT, ['('] = C_OPEN, [')'] = C_CLOSE,
+	['+'] = C_PLUS, ['-'] = C_MINUS, ['*'] = C_OP, ['/'] = C_OP, ['^'] = C_OP,
+	['0'] = C_DIGIT, ['1'] = C_DIGIT, ['2'] = C_DIGIT, ['3'] = C_DIGIT, ['4'] = C_DIGIT, ['5'] = C_DIGIT,
+	['6'] = C_DIGIT, ['7'] = C_DIGIT, ['8'] = C_DIGIT, ['9'] = C_DIGIT, ['a'] = C_NAME, ['b'] = C_NAME,
+	['c'] = C_NAME, ['d'] = C_NAME, ['e'] = C_NAME, ['f'] = C_NAME, ['g'] = C_NAME, ['h'] = C_NAME,
+	['i'] = C_NAME, ['j'] = C_NAME, ['k'] = C_NAME, ['l'] = C_NAME, ['m'] = C_NAME, ['n'] = C_NAME,
+	['o'] = C_NAME, ['p'] = C_NAME, ['q'] = C_NAME, ['r'] = C_NAME, ['s'] = C_NAME, ['t'] = C_NAME,
+	['u'] = C_NAME, ['v'] = C_NAME, ['w'] = C_NAME, ['x'] = C_NAME, ['y'] = C_NAME, ['z'] = C_NAME,
+	['A'] = C_NAME, ['B'] = C_NAME, ['C'] = C_NAME, ['D'] = C_NAME, ['E'] = C_NAME, ['F'] = C_NAME,
+	['G'] = C_NAME, ['H'] = C_NAME, ['I'] = C_NAME, ['J'] = C_NAME, ['K'] = C_NAME, ['L'] = C_NAME,
+	['M'] = C_NAME, ['N'] = C_NAME, ['O'] = C_NAME, ['P'] = C_NAME, ['Q'] = C_NAME, ['R'] = C_NAME,
+	['S'] = C_NAME, ['T'] = C_NAME, ['U'] = C_NAME, ['V'] = C_NAME, ['W'] = C_NAME, ['X'] = C_NAME,
+	['Y'] = C_NAME, ['Z'] = C_NAME, ['_'] = C_NAME,
+};
+
+#define CLASS(ch)	(char_class[(unsigned char)(ch)])
+
+// the state after a character of a class has been read in a state
+static const unsigned char trans[N_STATES][N_CLASSES] = {
+	/*           other   digit    .       name    (       )        +        -         op       \0 */
+	/* start */ {X_CHAR, S_DIGIT, X_CHAR, S_NAME, S_OPEN, X_START, S_UPLUS, S_UMINUS, X_START, X_CHAR},
+	/* (     */ {X_NEXT, S_DIGIT, X_NEXT, S_NAME, S_OPEN, X_NEXT,  S_UPLUS, S_UMINUS, X_NEXT,  X_CHAR},
+	/* )     */ {X_NEXT, X_NEXT,  X_NEXT, X_NEXT, X_NEXT, S_CLOSE, S_SIGN,  S_SIGN,   S_OP,    X_CHAR},
+	/* op    */ {X_NEXT, S_DIGIT, X_NEXT, S_NAME, S_OPEN, X_NEXT,  S_UPLUS, S_UMINUS, X_NEXT,  X_CHAR},
+	/* +-    */ {X_NEXT, S_DIGIT, X_NEXT, S_NAME, S_OPEN, X_NEXT,  S_UPLUS, S_UMINUS, X_NEXT,  X_CHAR},
+	/* u+    */ {X_NEXT, S_DIGIT, X_NEXT, S_NAME, X_NEXT, X_NEXT,  X_NEXT,  X_NEXT,   X_NEXT,  X_CHAR},
+	/* u-    */ {X_NEXT, S_DIGIT, X_NEXT, S_NAME, S_OPEN, X_NEXT,  X_NEXT,  X_NEXT,   X_NEXT,  X_CHAR},
+	/* digit */ {X_NEXT, S_DIGIT, S_DOT,  X_NEXT, X_NEXT, S_CLOSE, S_SIGN,  S_SIGN,   S_OP,    X_CHAR},
+	/* .     */ {X_NEXT, S_DIGIT, X_NEXT, X_NEXT, X_NEXT, X_NEXT,  X_NEXT,  X_NEXT,   X_NEXT,  X_CHAR},
+	/* name  */ {X_NEXT, S_NAME,  X_NEXT, S_NAME, X_NEXT, S_CLOSE, S_SIGN,  S_SIGN,   S_OP,    X_CHAR},
+};
+
+// the state of the first character of a token, when it's not the first one
+// of the expression; a + or - is unary after an operator or a (
+static const unsigned char tok_state[2][N_CLASSES] = {
+	{X_CHAR, S_DIGIT, X_CHAR, S_NAME, S_OPEN, S_CLOSE, S_SIGN,  S_SIGN,   S_OP, X_CHAR},
+	{X_CHAR, S_DIGIT, X_CHAR, S_NAME, S_OPEN, S_CLOSE, S_UPLUS, S_UMINUS, S_OP, X_CHAR},
+};
+
+// the classes after which a + or - is unary; these are the characters "(^*/+-"
+// and '\0', as they've always been looked up with strchr()
+static const bool before_unary[N_CLASSES] = {
+	[C_OPEN] = true, [C_PLUS] = true, [C_MINUS] = true, [C_OP] = true, [C_NUL] = true,
+};
+
+// the error when X_NEXT is reached from a state, and what's expected instead
+static const int next_code[N_STATES] = {
+	ERR_NONE, ERR_EXPECTED, ERR_UNEXPECTED, ERR_EXPECTED, ERR_EXPECTED,
+	ERR_EXPECTED, ERR_EXPECTED, ERR_EXPECTED, ERR_EXPECTED, ERR_UNEXPECTED,
+};
+static const char * const next_list[N_STATES] = {
+	"", "(+-", ")^*/+-", "(+-", "(+-", "", "(", ".)^*/+-", "", ")^*/+-",
+};
+
+// the states in which an expression can end
+static const bool can_end[N_STATES] = {
+	[S_START] = true, [S_CLOSE] = true, [S_DIGIT] = true, [S_NAME] = true,
+};
+
+// numbers go on with digits and dots, names with letters, digits, and _
+#define SAME_TOK(state, next) \
+	((S_NAME == (state)) ? (S_NAME == (next)) : \
+	((S_DIGIT == (state) || S_DOT == (state)) && (S_DIGIT == (next) || S_DOT == (next))))
+
+// saves the error in the context, unless there's one already
+static int report(Context * ctx, int code, int pos, int ch, int next, const char * list);
+
+// reports the error of reading curr, which has no state to go to from state
+static int bad_char(Context * ctx, const char * buff, const char * curr, int state, int what);
+
+// what's reported for the last character of a token which can't end an expression
+#define SHOWN(state, ch) \
+	((S_UPLUS == (state)) ? UNARY_PLUS : ((S_UMINUS == (state)) ? UNARY_MINUS : (ch)))
 
 /* --------------- MAIN CODE --------------- */
-int errchk(char * expr)
+int errchk(Context * ctx, char * expr)
 {
-	/* parse the expression in expr */
-	char * crr_lx = expr;
+	/* one lookup in the transition table per character; a token is done
+	 * when the character after it is good, then its unary operator is
+	 * translated, or its parenthesis closed */
+	int i, state, next;
 	
 	// must be zero in the end
 	int par_count = 0;
 	
-	err_code = 0;
-	while (*crr_lx != '\0')
+	errchk_start(ctx);
+	for (i = 0, state = S_START; expr[i]; ++i, state = next)
 	{
-		switch (*crr_lx)
-		{
-			case '(':
-				// ( expects digit | ( | + | -
-				expect(expr, crr_lx, "d(+-");
-				++par_count;
-				break;
-			case ')': 
-				// ) expects not first | ) | operator
-				expect(expr, crr_lx, "~)^*/+-");
-				--par_count;
-				break;
-			// unary + expect digit
-			// unary - expect digit | (
-			// non-unary +- expect digit | ( | + | -
-			case '+':
-				// check if unary and replace
-				if (crr_lx == expr || strchr("(^*/+-", *(crr_lx - 1)) )
-				{
-					expect(expr, crr_lx, "d");
-					*crr_lx = UNARY_PLUS;
-				}
-				else
-					expect(expr, crr_lx, "d(+-");
-				break;
-			case '-':
-				// check if unary and replace
-				if (crr_lx == expr || strchr("(^*/+-", *(crr_lx - 1)) )
-				{
-					expect(expr, crr_lx, "d(");
-					*crr_lx = UNARY_MINUS;
-				}	
-				else
-					expect(expr, crr_lx, "d(+-");
-				break;
-				// ^*/ expect not first | digit | ( | + | -
-			case '*':
-				expect(expr, crr_lx, "~d(+-");
-				break;
-			case '/':
-				expect(expr, crr_lx, "~d(+-");
-				break;
-			case '^':
-				expect(expr, crr_lx, "~d(+-");
-				break;
-			default:
-				; 	/* prevents error: a label can only be part of a statement 
-					/ and a declaration is not a statement */
-
-				// get numbers
-				if ( isdigit(*crr_lx) )
-				{
-					while (isdigit(*crr_lx) || '.' == *crr_lx)
-					{
-						if (isdigit(*crr_lx))
-						{
-							// digit expects digit| . | ) | op
-							expect(expr, crr_lx, "d.)^*/+-");
-						}
-						else
-						{
-							// . expects not first | digit
-							expect(expr, crr_lx, "~d");
-							// expect not last
-							expect(expr, crr_lx, "<");
-						}
-						++crr_lx;
-					}
-					// see end of loop
-					--crr_lx;
-				}
-				else
-				{
-					fprintf(stderr, "Err: invalid character < %c >\n", *crr_lx);
-					ERR_RETURN;
-				}
-				break;
-		}
-		// check if crr_lx is a valid last character
-		expect(expr, crr_lx, "<");
+		next = trans[state][CLASS(expr[i])];
+		if (next >= X_NEXT)
+			return bad_char(ctx, expr, expr + i, state, next);
 		
-		// on error go home
-		if (err_code)
-			return err_code;
-			
-		++crr_lx;
+		if (S_UPLUS == state)
+			expr[i - 1] = UNARY_PLUS;
+		else if (S_UMINUS == state)
+			expr[i - 1] = UNARY_MINUS;
+		else if (S_CLOSE == state && --par_count < 0)
+			ERR_RETURN(ERR_PARENS, i - 1, ')', '\0', "");
+		
+		if (S_OPEN == next)
+			++par_count;
 	}
 	
-	if (par_count != 0)
+	// the last token
+	if (S_CLOSE == state && --par_count < 0)
+		ERR_RETURN(ERR_PARENS, i - 1, ')', '\0', "");
+	if (!can_end[state])
+		ERR_RETURN(ERR_UNFINISHED, i - 1, SHOWN(state, expr[i - 1]), '\0', "");
+	
+	return errchk_end(ctx, par_count, i);
+}
+
+void errchk_start(Context * ctx)
+{
+	/* no errors yet */
+	ctx->err_code = ERR_NONE;
+	ctx->err_pos = 0;
+	return;
+}
+
+int err_set(Context * ctx, int code, int pos)
+{
+	/* for errors found outside of this file */
+	return report(ctx, code, pos, '\0', '\0', "");
+}
+
+int err_format(const Context * ctx, char * buff, size_t size)
+{
+	/* the messages errchk() has always printed */
+	switch (ctx->err_code)
 	{
-		puts("Err: umatched parentheses");
-		ERR_RETURN;
+		case ERR_NONE:
+			return snprintf(buff, size, "%s", "");
+		case ERR_INVALID_CHAR:
+			return snprintf(buff, size, "Err: invalid character < %c >\n", ctx->err_char);
+		case ERR_BAD_START:
+			return snprintf(buff, size, "Err: < %c > can't begin an expression\n", ctx->err_char);
+		case ERR_EXPECTED:
+			return snprintf(buff, size, "Err: a digit or one of '%s' expected instead of < %c >\n",
+			ctx->err_list, ctx->err_next);
+		case ERR_UNEXPECTED:
+			return snprintf(buff, size, "Err: < %c > should be followed by one of '%s'\n"
+			"but it is instead followed by < %c >\n", ctx->err_char, ctx->err_list, ctx->err_next);
+		case ERR_UNFINISHED:
+			return snprintf(buff, size, "Err: unfinished expression; < %c > can't be last\n",
+			ctx->err_char);
+		case ERR_PARENS:
+			return snprintf(buff, size, "Err: umatched parentheses\n");
+		case ERR_NO_NUMBERS:
+			return snprintf(buff, size, "Err: no numbers\n");
+		case ERR_DEPTH:
+			return snprintf(buff, size, "Err: parentheses nested deeper than %d\n", ctx->max_depth);
+		default:
+			return snprintf(buff, size, "Err: memory allocation failed\n");
 	}
-	
-	return err_code;
 }
 
-static int expect(const char * buff, const char * curr, const char * list)
+int errchk_tok(Context * ctx, const char * expr, const char * crr_lx, const char * end, 
+	int * par_count, int * tok)
 {
-	/* expect the next char to be containted in list
-	 * if it's not, an error is reported
-	 * 'd' means 'decimal digit', '~' means 'not first'
-	 * '~' and 'd' must appear first in the list and '~' must be before 'd' 
-	 * < means 'can't be last' and should appear in the list by itself */
-	const char * list_start = list;
+	/* check the token at crr_lx, and the character after it */
+	const char * tok_start = crr_lx;
+	int state, next;
+	
+	if (crr_lx == expr)
+		state = trans[S_START][CLASS(*crr_lx)];
+	else
+		state = tok_state[before_unary[CLASS(*(crr_lx - 1))]][CLASS(*crr_lx)];
 	
-	if ('<' == *list_start)
+	if (state >= X_NEXT)
 	{
-		// check for valid last character
-		if ( ('\0' == *(curr + 1)) && (!isdigit(*curr)) && (*curr != ')') )
-		{
-			fprintf(stderr, "Err: unfinished expression; < %c > can't be last\n", *curr);
-			ERR_RETURN;
-		}
+		bad_char(ctx, expr, crr_lx, S_START, state);
 		return 0;
 	}
 	
-	while ('~' == *list_start || 'd' == *list_start)
+	switch (state)
 	{
-		switch (*list_start)
-		{
-			case '~':
-				// check for 'not first'
-				if (curr == buff)
-				{
-					fprintf(stderr, "Err: < %c > can't begin an expression\n", *curr);
-					ERR_RETURN;
-				}
-				break;
-			case 'd':
-				// check for digit
-				if (!isdigit(*(curr + 1)) )
-				{
-					// if current character is not a digit, 
-					// but it's still in the list it's fine
-					if (strchr(list_start + 1, *(curr + 1)) != NULL)
-						return 0;
-					
-					fprintf(stderr, "Err: a digit or one of '%s' expected instead of < %c >\n",
-					list_start + 1,*(curr + 1));
-					ERR_RETURN;
-				}
-				else
-					return 0;
-				break;
-			default:
-				break;
-		}
-		++list_start;
+		case S_UPLUS: *tok = UNARY_PLUS; break;
+		case S_UMINUS: *tok = UNARY_MINUS; break;
+		case S_DIGIT: *tok = NUMBER; break;
+		case S_NAME: *tok = NAME; break;
+		default: *tok = *crr_lx; break;
 	}
 	
-	// check next character from the expression
-	if (strchr(list_start, *(curr + 1)) == NULL)
+	// the end is always a good next character; a '\0' before it is
+	// the next token's problem
+	while (crr_lx + 1 < end)
 	{
-		fprintf(stderr, "Err: < %c > should be followed by one of '%s'\n", *curr, list_start);
-		fprintf(stderr, "but it is instead followed by < %c >\n", *(curr + 1));
-		ERR_RETURN;
+		next = trans[state][CLASS(*(crr_lx + 1))];
+		if (X_NEXT == next)
+			bad_char(ctx, expr, crr_lx + 1, state, next);
+		if (next >= X_NEXT || !SAME_TOK(state, next))
+			break;
+		
+		++crr_lx;
+		state = next;
 	}
-	return 0;
-}
\ No newline at end of file
+	
+	if (S_OPEN == state)
+		++*par_count;
+	else if (S_CLOSE == state && --*par_count < 0)
+	{
+		// can't close what's not open
+		report(ctx, ERR_PARENS, crr_lx - expr, *crr_lx, '\0', "");
+		return 0;
+	}
+	
+	// check if crr_lx is a valid last character
+	// unary operators are reported in their internal representation
+	if (crr_lx + 1 == end && !can_end[state])
+		report(ctx, ERR_UNFINISHED, crr_lx - expr, SHOWN(state, *crr_lx), '\0', "");
+	
+	if (ctx->err_code)
+		return 0;
+	
+	return crr_lx - tok_start + 1;
+}
+
+int errchk_end(Context * ctx, int par_count, int len)
+{
+	/* every parenthesis must be closed */
+	if (par_count != 0)
+		ERR_RETURN(ERR_PARENS, len, '\0', '\0', "");
+	
+	return ctx->err_code;
+}
+
+static int bad_char(Context * ctx, const char * buff, const char * curr, int state, int what)
+{
+	/* the error is the character before for X_NEXT, this one otherwise */
+	if (X_NEXT == what)
+		ERR_RETURN(next_code[state], curr - buff, *(curr - 1), *curr, next_list[state]);
+	if (X_START == what)
+		ERR_RETURN(ERR_BAD_START, curr - buff, *curr, '\0', "");
+	ERR_RETURN(ERR_INVALID_CHAR, curr - buff, *curr, '\0', "");
+}
+
+static int report(Context * ctx, int code, int pos, int ch, int next, const char * list)
+{
+	/* the first error is the one that counts */
+	if (ERR_NONE == ctx->err_code)
+	{
+		ctx->err_code = code;
+		ctx->err_pos = pos;
+		ctx->err_char = ch;
+		ctx->err_next = next;
+		ctx->err_list = list;
+	}
+	
+	return ctx->err_code;
+}
@@ -3,14 +3,68 @@
 #ifndef ERRCHK_H_
 #define ERRCHK_H_
 
+#include <stddef.h>
+#include "context.h"
+
 #define UNARY_PLUS	' '
 #define UNARY_MINUS	'u'
 
-int errchk(char * expr);
+// errchk_tok() token types for numbers and names
+#define NUMBER		'0'
+#define NAME		'a'
+
+int errchk(Context * ctx, char * expr);
 /*
-returns: 1 on error in the expression, 0 otherwise
+returns: one of the error codes in context.h, ERR_NONE if expr is valid
 
 description: Goes through expr and determines if it contains a valid 
-infix expression. If the expression is not valid an error message is displayed.
+infix expression. If the expression is not valid the first error is left in ctx, 
+ready for err_format(). Translates the unary operators in expr to UNARY_PLUS and UNARY_MINUS.
+*/
+
+void errchk_start(Context * ctx);
+/*
+returns: nothing
+
+description: Clears the error state of ctx. Must be called before the first 
+errchk_tok() of an expression.
+*/
+
+int errchk_tok(Context * ctx, const char * expr, const char * curr, const char * end, 
+	int * par_count, int * tok);
+/*
+returns: the length of the token which begins at curr, 0 on error
+
+description: Checks a single token of the expression which begins at expr and ends 
+before end, exactly like errchk() does, and reports errors the same way. curr must 
+point at the beginning of a token. *par_count is the number of open parentheses so far 
+and must be 0 for the first token. *tok is set to the operator character, UNARY_PLUS, 
+UNARY_MINUS, NUMBER, or NAME. Names begin with a letter or _ and go on with letters, 
+digits, and _. expr is not changed. Errors are left in ctx->err_code.
+*/
+
+int errchk_end(Context * ctx, int par_count, int len);
+/*
+returns: ctx->err_code
+
+description: Finishes the check of an expression of length len after all of its 
+tokens have been checked by errchk_tok(). Unmatched parentheses are reported at len.
+*/
+
+int err_set(Context * ctx, int code, int pos);
+/*
+returns: ctx->err_code
+
+description: Sets the error of ctx to code at offset pos, unless an error is 
+already set. For errors found after the check, like ERR_MEMORY.
+*/
+
+int err_format(const Context * ctx, char * buff, size_t size);
+/*
+returns: the length of the message, like snprintf()
+
+description: Writes the message for the error in ctx to buff, which is size bytes 
+big, ending in a new line. ERR_MSG_SIZE is always enough. The message is empty 
+when there's no error.
 */
 #endif
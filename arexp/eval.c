@@ -1,20 +1,34 @@
 /* aval.c -- evaluates infix arithmetic expressions */
-/* works by going through the expression, saving the numbers
- * in an array, the unary minus operations in a queue, the exponentiation
+/* works by going through the expression, checking every token with
+ * errchk_tok() as it's read, saving the numbers
+ * in an array (a name gets a slot which is filled from its variable before
+ * evaluation), the unary minus operations in a queue, the exponentiation
  * operations on a stack (since exponentiation is right associative),
  * multiplcation and division in a queue, addition and subtraction in a queue;
- * after that, the operations are performed in order, substituting their left
+ * after that, the operations are recorded in order, substituting their left
  * operands with the result (in case of unary minus the number is just negated);
- * parentheses are handled by evaluating the expression inside them recursively */
+ * the operators inside parentheses wait in a frame of their own, on an explicit
+ * stack of frames, and are recorded when the parenthesis is closed, so nesting
+ * costs memory, not calls; the queues and stacks are arrays, kept in the frames
+ * between calls;
+ * the recorded operations are then performed by evaluate() as many times
+ * as needed without looking at the string again */
 
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
-#include <ctype.h>
+#include <string.h>
 #include <math.h>
-#include "stack.h"
-#include "queue.h"
+#include "pool.h"
+#include "vstack.h"
+#include "rqueue.h"
 #include "errchk.h"
+#include "numconv.h"
+#include "jit.h"
+#include "opt.h"
+#include "par.h"
+#include "stats.h"
+#include "pratt.h"
 #include "eval.h"
 
 // operator record
@@ -24,318 +38,821 @@ typedef struct op_record_ {
 	int pos_right_num;
 } op_rec;
 
-// number record
-// holds a numbed and a flag
-// the flag shows if the number has been consumed by another operator
-typedef struct num_record_ {
-	bool empty;
-	double num;
-} num_rec;
+// the compile time state is kept in the context:
+// ctx->num_link - the number buffer; a number which has been consumed by another operator
+//                 links to a number on its left, a number which hasn't links to itself
+// ctx->nb_count - the number buffer counter
+// ctx->expr, ctx->buff_end - the expression string
+// ctx->buff_ptr - points to the next token
+// ctx->par_count - open parentheses so far
+// ctx->frames - a frame for every open parenthesis, ctx->frames[ctx->par_count] is the innermost
+// ctx->curr_cexp - the expression being compiled
+// ctx->pool - operator records are taken from here
 
-#define NUM_BUFF_SIZE 	256
-// the number buffer
-static num_rec num_buff[NUM_BUFF_SIZE];
-
-// the number buffer counter
-static int nb_count;
-
-// verbose prints out operations as they are performed
-static bool verbose = true;
-
-// see eval.h
-extern int f_prec;
-
-// creates an operator record
-static op_rec * make_op_rec(void);
+// creates an operator record; NULL on failure
+static op_rec * make_op_rec(Context * ctx);
 
 // pushes an operation on a stack
-static void push_op(Stack * s, op_rec * orc, int op);
+static void push_op(Context * ctx, VStack * s, op_rec * orc, int op);
 
 // enqueues an operation in a queue
-static void enq_op(Queue * q, op_rec * orc, int op);
+static void enq_op(Context * ctx, RQueue * q, op_rec * orc, int op);
 
-// gets the left operand for an operation
-static double * get_left_num(int curr_pos);
+// gets the position of the left operand for an operation
+static int get_left_num(Context * ctx, int curr_pos);
 
 // queue constants
-enum {	
+enum {
 		UNR_Q,	// unary queue
 		MD_Q, 	// multiplcation/division queue
 		AS_Q, 	// addition/subtraction queue
 		NUM_QS	// the number of queues
 };
 
-// performs the actual calculations
-static void eval(Queue * qs[], Stack * s);
+// the operators waiting for their expression, or parenthesis, to end
+typedef struct parse_frame_ {
+	VStack pow_stk;
+	RQueue qs[NUM_QS];
+} parse_frame;
+
+// readies the frame for depth; NULL on failure
+static parse_frame * frame_init(Context * ctx, int depth);
+
+// records the operations in order of evaluation
+static void emit(Context * ctx, parse_frame * fr);
+
+// records a binary operation and consumes its right operand
+static void emit_binary(Context * ctx, op_rec * opr);
+
+// performs the operations of cexp in work
+static void run(double * work, const comp_expr * cexp);
 
-// parses the string and calls eval()
-static double parse(const char * expr);
+// same as run(), recording and printing the steps
+static int run_traced(Context * ctx, double * work, const comp_expr * cexp);
 
-// points to the expression string
-static const char * buff_ptr = NULL;
+// prints the first n_steps recorded steps
+static int print_steps(Context * ctx, int n_steps);
+
+// makes sure ctx has room for n_steps recorded steps
+static int steps_reserve(Context * ctx, int n_steps);
+
+// makes sure the trace text buffer of ctx is at least size bytes big
+static int text_reserve(Context * ctx, size_t size);
+
+// checks and parses the string and calls emit()
+static int parse(Context * ctx);
+
+// makes sure cexp has room for the given number of numbers and operations
+static int comp_reserve(comp_expr * cexp, int n_nums, int n_code);
+
+// adds a load of the variable called by the len characters at name to slot
+static void add_load(Context * ctx, comp_expr * cexp, const char * name, int len, int slot);
+
+// reports a failed allocation in ctx
+static int alloc_failed(Context * ctx);
+
+// same as above, when evaluating
+static double eval_failed(Context * ctx);
 
 /* --------------- MAIN CODE --------------- */
-double calculate(char * expr)
+double calculate(Context * ctx, const char * expr)
+{
+	/* compile and evaluate once */
+	double result;
+	int ret;
+
+	// in one pass, unless there's something only compile() does
+	if (ENGINE_PRATT == ctx->engine && !ctx->verbose && !ctx->keep_stats)
+	{
+		ret = pratt_calc(ctx, expr, strlen(expr), &result);
+		if (ret != PRATT_NAMES)
+			return result;
+	}
+
+	if (NULL == ctx->calc_cexp)
+	{
+		if ( (ctx->calc_cexp = malloc(sizeof(*ctx->calc_cexp))) == NULL)
+			return eval_failed(ctx);
+		comp_init(ctx->calc_cexp);
+	}
+
+	if (compile(ctx, ctx->calc_cexp, expr) != 0)
+		return NAN;
+
+	return evaluate(ctx, ctx->calc_cexp);
+}
+
+void comp_init(comp_expr * cexp)
+{
+	/* no storage until the first compile() */
+	cexp->n_nums = cexp->n_code = cexp->result = 0;
+	cexp->nums_size = cexp->code_size = 0;
+	cexp->nums = NULL;
+	cexp->code = NULL;
+	cexp->n_vars = cexp->n_loads = 0;
+	cexp->vars = NULL;
+	cexp->loads = NULL;
+	cexp->native = NULL;
+	cexp->native_mem = NULL;
+	cexp->native_size = 0;
+	cexp->optimized = false;
+	cexp->orig = NULL;
+	cexp->plan = NULL;
+	return;
+}
+
+void comp_destroy(comp_expr * cexp)
+{
+	/* free the storage */
+	int i;
+
+	for (i = 0; i < cexp->n_vars; ++i)
+		free(cexp->vars[i].name);
+	free(cexp->nums);
+	free(cexp->code);
+	free(cexp->vars);
+	free(cexp->loads);
+	jit_release(cexp);
+	opt_release(cexp);
+	par_release(cexp);
+	comp_init(cexp);
+	return;
+}
+
+int comp_bind(comp_expr * cexp, const char * name, const double * src)
+{
+	/* there are few variables, so look them up linearly */
+	int i;
+
+	for (i = 0; i < cexp->n_vars; ++i)
+	{
+		if (strcmp(cexp->vars[i].name, name) == 0)
+		{
+			cexp->vars[i].src = src;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+const char * comp_unbound(const comp_expr * cexp)
+{
+	/* first come, first reported */
+	int i;
+
+	for (i = 0; i < cexp->n_vars; ++i)
+	{
+		if (NULL == cexp->vars[i].src)
+			return cexp->vars[i].name;
+	}
+
+	return NULL;
+}
+
+void compile_destroy(Context * ctx)
+{
+	/* the frames and their buffers */
+	parse_frame * fr;
+	int i, j;
+
+	for (i = 0; i < ctx->frames_size; ++i)
+	{
+		fr = &ctx->frames[i];
+		vstack_destroy(&fr->pow_stk);
+		for (j = 0; j < NUM_QS; ++j)
+			rqueue_destroy(&fr->qs[j]);
+	}
+	free(ctx->frames);
+	ctx->frames = NULL;
+	ctx->frames_size = 0;
+	return;
+}
+
+int compile(Context * ctx, comp_expr * cexp, const char * expr)
+{
+	/* the whole string */
+	return compile_len(ctx, cexp, expr, strlen(expr));
+}
+
+int compile_len(Context * ctx, comp_expr * cexp, const char * expr, int len)
 {
-	/* prepare and send to parse() */
-	
-	// set pointer
-	buff_ptr = expr;
-	
+	/* prepare and send to parse(), which checks as it goes */
+	long heap_calls = ctx->pool.heap_calls + ctx->heap_calls;
+	double start = 0.0;
+	int i, ret;
+
+	if (ctx->keep_stats)
+		start = stats_now();
+
+	errchk_start(ctx);
+
+	// forget the variables of the last expression
+	for (i = 0; i < cexp->n_vars; ++i)
+		free(cexp->vars[i].name);
+	cexp->n_vars = cexp->n_loads = 0;
+	cexp->native = NULL;
+	cexp->optimized = false;
+	par_release(cexp);
+
+	// numbers are separated by at least one operator, and
+	// every operator is a character of its own
+	if (comp_reserve(cexp, len / 2 + 1, len) != 0 || context_reserve(ctx, len / 2 + 1) != 0)
+		return err_set(ctx, ERR_MEMORY, 0);
+
+	// set pointers
+	ctx->expr = ctx->buff_ptr = expr;
+	ctx->buff_end = expr + len;
+	ctx->curr_cexp = cexp;
+	cexp->n_code = 0;
+
 	// initiate the num_buff counter
-	nb_count = -1;
-	
-	return parse(expr);
+	ctx->nb_count = -1;
+	ctx->par_count = 0;
+
+	ret = parse(ctx);
+	if (0 == ret)
+		ret = errchk_end(ctx, ctx->par_count, len);
+
+	// everything taken from the pool is free by now,
+	// or not needed anymore
+	pool_reset(&ctx->pool);
+
+	if (ctx->keep_stats)
+	{
+		ctx->stats.t_compile += stats_now() - start;
+		ctx->stats.heap_calls += ctx->pool.heap_calls + ctx->heap_calls - heap_calls;
+		++ctx->stats.exprs;
+		if (ret != 0)
+			++ctx->stats.errors;
+		else
+		{
+			ctx->stats.numbers += ctx->nb_count + 1;
+			ctx->stats.operators += cexp->n_code;
+			if (ctx->nb_count + 1 > ctx->stats.peak_nums)
+				ctx->stats.peak_nums = ctx->nb_count + 1;
+		}
+	}
+
+	if (ret != 0)
+		return ctx->err_code;
+
+	cexp->n_nums = ctx->nb_count + 1;
+
+	i = 0;
+	// at this point only the result is left, find it
+	while (ctx->num_link[i] != i)
+		++i;
+	cexp->result = i;
+
+	// a huge expression is done by many threads instead
+	if (ctx->par_threads > 1 && par_compile(cexp) == 0)
+		return 0;
+
+	// an operation can add at most one slot; without the room, or
+	// when optimize() fails, cexp stays as it is
+	if (ctx->optimize && comp_reserve(cexp, cexp->n_nums + cexp->n_code, cexp->n_code) == 0)
+		optimize(ctx, cexp);
+
+	// the interpreter is there if this fails
+	if (ctx->jit)
+		jit_compile(cexp);
+
+	return 0;
 }
 
-static double parse(const char * expr)
+double evaluate(Context * ctx, const comp_expr * cexp)
 {
-	/* parse the expression */
-	
-	// stack for right associative
-	Stack pow_stk_;
-	Stack * pow_stk = &pow_stk_;
-	
-	// queues for left associative and unary
-	Queue unr_q, md_q, as_q;
-	Queue * q_list[] = {&unr_q, &md_q, &as_q};
-	op_rec * pop_r = NULL;
+	/* perform the recorded operations on a copy of the numbers */
+	double * work;
+	const comp_var * var;
+	double start = 0.0;
 	int i;
-	
-	// initiate
-	stack_init(pow_stk, NULL);
-	for (i = 0; i < NUM_QS; ++i)
-		queue_init(q_list[i], NULL);
+
+	if (ctx->keep_stats)
+		start = stats_now();
+
+	// the trace is that of the expression as written
+	if (ctx->verbose && cexp->optimized)
+		cexp = cexp->orig;
+
+	if (context_reserve(ctx, cexp->n_nums) != 0)
+		return eval_failed(ctx);
+	work = ctx->work;
+
+	memcpy(work, cexp->nums, cexp->n_nums * sizeof(*work));
+	for (i = 0; i < cexp->n_loads; ++i)
+	{
+		var = &cexp->vars[cexp->loads[i].var];
+		work[cexp->loads[i].slot] = (var->src != NULL) ? *var->src : NAN;
+	}
+
+	if (!ctx->verbose)
+	{
+		if (cexp->plan != NULL)
+			par_run(ctx, work, cexp);
+		else if (cexp->native != NULL)
+			cexp->native(work);
+		else
+			run(work, cexp);
+	}
+	else if (run_traced(ctx, work, cexp) != 0)
+		return eval_failed(ctx);
+
+	if (ctx->keep_stats)
+	{
+		ctx->stats.t_eval += stats_now() - start;
+		++ctx->stats.evals;
+	}
+
+	return work[cexp->result];
+}
+
+static void run(double * work, const comp_expr * cexp)
+{
+	/* nothing but the arithmetic */
+	const instr * ins, * end;
+
+	for (ins = cexp->code, end = ins + cexp->n_code; ins < end; ++ins)
+	{
+		switch (ins->op)
+		{
+			case UNARY_MINUS:
+				// negate number
+				work[ins->dst] = -work[ins->rhs];
+				break;
+			case '^':
+				work[ins->dst] = pow(work[ins->lhs], work[ins->rhs]);
+				break;
+			case '*':
+				work[ins->dst] = work[ins->lhs] * work[ins->rhs];
+				break;
+			case '/':
+				work[ins->dst] = work[ins->lhs] / work[ins->rhs];
+				break;
+			case '+':
+				work[ins->dst] = work[ins->lhs] + work[ins->rhs];
+				break;
+			default:
+				work[ins->dst] = work[ins->lhs] - work[ins->rhs];
+				break;
+		}
+	}
+
+	return;
+}
+
+static int run_traced(Context * ctx, double * work, const comp_expr * cexp)
+{
+	/* record the steps first and format them all in the end,
+	 * so the arithmetic isn't held up by printing */
+	const instr * ins, * end;
+	trace_step * stp;
+	double reslt;
+
+	if (steps_reserve(ctx, cexp->n_code) != 0)
+		return -1;
+	stp = ctx->steps;
+
+	for (ins = cexp->code, end = ins + cexp->n_code; ins < end; ++ins)
+	{
+		switch (ins->op)
+		{
+			case UNARY_MINUS:
+				// negate number; not printed
+				work[ins->dst] = -work[ins->rhs];
+				continue;
+				break;
+			case '^':
+				reslt = pow(work[ins->lhs], work[ins->rhs]);
+				break;
+			case '*':
+				reslt = work[ins->lhs] * work[ins->rhs];
+				break;
+			case '/':
+				reslt = work[ins->lhs] / work[ins->rhs];
+				break;
+			case '+':
+				reslt = work[ins->lhs] + work[ins->rhs];
+				break;
+			default:
+				reslt = work[ins->lhs] - work[ins->rhs];
+				break;
+		}
+
+		stp->op = ins->op;
+		stp->lhs = work[ins->lhs];
+		stp->rhs = work[ins->rhs];
+		stp->result = reslt;
+		++stp;
+
+		work[ins->dst] = reslt;
+	}
+
+	return print_steps(ctx, stp - ctx->steps);
+}
+
+static int print_steps(Context * ctx, int n_steps)
+{
+	/* format in the text buffer, growing it when a step doesn't fit,
+	 * and write it out at once */
+	const trace_step * stp;
+	size_t len = 0;
+	int i, n;
+
+	for (i = 0; i < n_steps; ++i)
+	{
+		stp = &ctx->steps[i];
+		while (true)
+		{
+			n = snprintf(ctx->trace_text + len, ctx->trace_size - len, "%.*f %c %.*f = %.*f\n",
+			ctx->f_prec, stp->lhs, stp->op, ctx->f_prec, stp->rhs, ctx->f_prec, stp->result);
+
+			if ((size_t)n < ctx->trace_size - len)
+				break;
+			if (text_reserve(ctx, len + n + 1) != 0)
+				return -1;
+		}
+		len += n;
+	}
+
+	fwrite(ctx->trace_text, 1, len, stdout);
+	return 0;
+}
+
+static int steps_reserve(Context * ctx, int n_steps)
+{
+	/* grow to at least double the size */
+	trace_step * new_steps;
+	int new_size;
+
+	if (n_steps <= ctx->steps_size)
+		return 0;
+
+	new_size = (ctx->steps_size * 2 > n_steps) ? ctx->steps_size * 2 : n_steps;
+	if ( (new_steps = realloc(ctx->steps, new_size * sizeof(*new_steps))) == NULL)
+		return -1;
+	ctx->steps = new_steps;
+	ctx->steps_size = new_size;
+	return 0;
+}
+
+static int text_reserve(Context * ctx, size_t size)
+{
+	/* same as above */
+	char * new_text;
+	size_t new_size;
+
+	new_size = (ctx->trace_size * 2 > size) ? ctx->trace_size * 2 : size;
+	if ( (new_text = realloc(ctx->trace_text, new_size)) == NULL)
+		return -1;
+	ctx->trace_text = new_text;
+	ctx->trace_size = new_size;
+	return 0;
+}
+
+static int parse(Context * ctx)
+{
+	/* check and parse the expression */
+	parse_frame * fr;
+	op_rec * pop_r = NULL;
+	const char * tok_start;
+	int depth = 0, len, tok, num_len;
+
+	if ( (fr = frame_init(ctx, depth)) == NULL)
+		return 1;
 
 	// go through the string
-	while (*buff_ptr != '\0')
+	while (ctx->buff_ptr < ctx->buff_end)
 	{
-		switch (*buff_ptr)
+		// check the token first; on error go home
+		tok_start = ctx->buff_ptr;
+		len = errchk_tok(ctx, ctx->expr, tok_start, ctx->buff_end, &ctx->par_count, &tok);
+		if (0 == len)
+			return 1;
+		ctx->buff_ptr += len;
+
+		switch (tok)
 		{
 			case '(':
-				// recursive call for expression in parentheses
-				parse(++buff_ptr);
+				// a new frame for the expression in parentheses
+				if (ctx->max_depth > 0 && depth == ctx->max_depth)
+				{
+					err_set(ctx, ERR_DEPTH, tok_start - ctx->expr);
+					return 1;
+				}
+				if ( (fr = frame_init(ctx, ++depth)) == NULL)
+					return 1;
 				break;
-			case ')': 
-				// evaluate
-				eval(q_list, pow_stk);
-				// return from recursive call
-				return 0;
+			case ')':
+				// record and go back to the frame around it
+				emit(ctx, fr);
+				fr = &ctx->frames[--depth];
 				break;
 			case UNARY_PLUS:
 				// do nothing
 				break;
 			case '+':
-				enq_op(q_list[AS_Q], pop_r, *buff_ptr);
+				enq_op(ctx, &fr->qs[AS_Q], pop_r, tok);
 				break;
 			case UNARY_MINUS:
-				enq_op(q_list[UNR_Q], pop_r, *buff_ptr);
+				enq_op(ctx, &fr->qs[UNR_Q], pop_r, tok);
 				break;
 			case '-':
-				enq_op(q_list[AS_Q], pop_r, *buff_ptr);
+				enq_op(ctx, &fr->qs[AS_Q], pop_r, tok);
 				break;
 			case '*':
-				enq_op(q_list[MD_Q], pop_r, *buff_ptr);
+				enq_op(ctx, &fr->qs[MD_Q], pop_r, tok);
 				break;
 			case '/':
-				enq_op(q_list[MD_Q], pop_r, *buff_ptr);
+				enq_op(ctx, &fr->qs[MD_Q], pop_r, tok);
 				break;
 			case '^':
-				push_op(pow_stk, pop_r, *buff_ptr);
+				push_op(ctx, &fr->pow_stk, pop_r, tok);
+				break;
+			case NAME:
+				// a slot for the value of the variable
+				++ctx->nb_count;
+				ctx->num_link[ctx->nb_count] = ctx->nb_count;
+				ctx->curr_cexp->nums[ctx->nb_count] = 0.0;
+				add_load(ctx, ctx->curr_cexp, tok_start, len, ctx->nb_count);
 				break;
 			default:
-				; 	/* prevents error: a label can only be part of a statement 
-					/ and a declaration is not a statement */
-				const char * num_start = buff_ptr;
-				
-				// eat numbers
-				while (isdigit(*buff_ptr) || '.' == *buff_ptr)
-					++buff_ptr;
-				
-				// check num_buff size
-				++nb_count;
-				if (nb_count >= NUM_BUFF_SIZE)
-				{
-					fprintf(stderr, "Err: too many numbers\n");
-					fprintf(stderr, "No more than %d numbers are supported in a single expression\n", 
-					NUM_BUFF_SIZE);
-					exit(EXIT_FAILURE);
-				}
-				
-				// read number
-				num_buff[nb_count].empty = false;
-				sscanf(num_start, "%lf", &num_buff[nb_count].num);
-				
-				// see four lines down
-				--buff_ptr;
+				// read number; the checker has already eaten it
+				// a second decimal point ends the number, as it always has
+				++ctx->nb_count;
+				ctx->num_link[ctx->nb_count] = ctx->nb_count;
+				ctx->curr_cexp->nums[ctx->nb_count] =
+					numconv(tok_start, ctx->buff_ptr, &num_len);
 				break;
 		}
-		++buff_ptr;
+
+		// out of memory, or the checker found something after the token
+		if (ctx->err_code != ERR_NONE)
+			return 1;
+	}
+
+	// record; parentheses left open are recorded innermost first,
+	// then errchk_end() reports them
+	for ( ; depth >= 0 && ERR_NONE == ctx->err_code; --depth)
+		emit(ctx, &ctx->frames[depth]);
+	return (ctx->err_code != ERR_NONE);
+}
+
+static parse_frame * frame_init(Context * ctx, int depth)
+{
+	/* grow to at least double the size, then start empty; the buffers
+	 * of the queues and the stack stay with the frame */
+	parse_frame * new_frames, * fr;
+	int i, new_size;
+
+	if (depth >= ctx->frames_size)
+	{
+		new_size = (ctx->frames_size * 2 > depth + 1) ? ctx->frames_size * 2 : depth + 1;
+		if ( (new_frames = realloc(ctx->frames, new_size * sizeof(*new_frames))) == NULL)
+		{
+			alloc_failed(ctx);
+			return NULL;
+		}
+		ctx->frames = new_frames;
+		++ctx->heap_calls;
+		for ( ; ctx->frames_size < new_size; ++ctx->frames_size)
+		{
+			fr = &ctx->frames[ctx->frames_size];
+			vstack_init(&fr->pow_stk, NULL);
+			for (i = 0; i < NUM_QS; ++i)
+				rqueue_init(&fr->qs[i], NULL);
+		}
 	}
-	
-	// evaluate
-	eval(q_list, pow_stk);
-	
-	i = 0;
-	// at this point only the result is left, get it
-	while (true == num_buff[i].empty)
-		++i;
-	
-	// marking the result as empty marks the whole num_buff[] as empty
-	num_buff[i].empty = true;
 
-	return num_buff[i].num;
+	fr = &ctx->frames[depth];
+	vstack_clear(&fr->pow_stk);
+	for (i = 0; i < NUM_QS; ++i)
+		rqueue_clear(&fr->qs[i]);
+	return fr;
 }
 
-static void eval(Queue * qs[], Stack * s)
+static void emit(Context * ctx, parse_frame * fr)
 {
-	/* evaluate in order:
+	/* record in order:
 	 * negation
-	 * exponentiation 
+	 * exponentiation
 	 * multiplication/division
 	 * addition/subtraction */
-	 
+
+	RQueue * qs = fr->qs;
+	VStack * s = &fr->pow_stk;
 	op_rec * opr;
-	num_rec * nr;
+	instr * ins;
 	void * data;
-	double * left_num, * right_num, reslt;
-	
-	if (nb_count < 0)
+
+	if (ctx->nb_count < 0)
 	{
-		fprintf(stderr, "Err: no numbers\n");
-		exit(EXIT_FAILURE);
+		err_set(ctx, ERR_NO_NUMBERS, ctx->buff_ptr - ctx->expr);
+		return;
 	}
-		
-	while (qs[UNR_Q]->size != 0)
+
+	while (qs[UNR_Q].size != 0)
 	{
 		// get operation from the unary queue
-		queue_deq(qs[UNR_Q], &data);
+		rqueue_deq(&qs[UNR_Q], &data);
 		opr = (op_rec *)data;
-		// read right operand
-		nr = &num_buff[opr->pos_right_num];
-		right_num = &nr->num;
-		
-		// negate number
-		*right_num = -(*right_num);
-		free(data);
+
+		// negate the right operand in place
+		ins = &ctx->curr_cexp->code[ctx->curr_cexp->n_code++];
+		ins->op = opr->op;
+		ins->dst = ins->lhs = ins->rhs = opr->pos_right_num;
+		pool_free(&ctx->pool, data);
 	}
 
 	while (s->size != 0)
 	{
 		// get exponentiation operand from the stack
-		stack_pop(s, &data);
-		opr = (op_rec *)data;
-		nr = &num_buff[opr->pos_right_num];
-		// read right operand
-		right_num = &nr->num;
-		// find left operand
-		left_num = get_left_num(opr->pos_right_num);
-		// perform exponentiation
-		reslt = pow(*left_num, *right_num);
-		
-		// print or not
-		if (verbose)
-			printf("%.*f %c %.*f = %.*f\n", 
-			f_prec, *left_num, opr->op, f_prec, *right_num, f_prec, reslt);
-		
-		// save result in the left operand
-		*left_num = reslt;
-		// mark the right operand as empty
-		nr->empty = true;
-		free(data);
+		vstack_pop(s, &data);
+		emit_binary(ctx, (op_rec *)data);
+		pool_free(&ctx->pool, data);
 	}
 
-	while (qs[MD_Q]->size != 0)
+	while (qs[MD_Q].size != 0)
 	{
-		// logic smilira as above
-		queue_deq(qs[MD_Q], &data);
-		opr = (op_rec *)data;
-		nr = &num_buff[opr->pos_right_num];
-		right_num = &nr->num;
-		left_num = get_left_num(opr->pos_right_num);
-		
-		if ('*' == opr->op)
-			reslt = *left_num * *right_num;
-		else
-			reslt = *left_num / *right_num;
-		
-		if (verbose)
-			printf("%.*f %c %.*f = %.*f\n", 
-			f_prec, *left_num, opr->op, f_prec, *right_num, f_prec, reslt);
-		
-		*left_num = reslt;
-		nr->empty = true;
-		free(data);
+		// logic similar as above
+		rqueue_deq(&qs[MD_Q], &data);
+		emit_binary(ctx, (op_rec *)data);
+		pool_free(&ctx->pool, data);
 	}
 
-	while (qs[AS_Q]->size != 0)
+	while (qs[AS_Q].size != 0)
 	{
 		// logic similar as above
-		queue_deq(qs[AS_Q], &data);
-		opr = (op_rec *)data;
-		nr = &num_buff[opr->pos_right_num];
-		right_num = &nr->num;
-		left_num = get_left_num(opr->pos_right_num);
-		
-		if ('+' == opr->op)
-			reslt = *left_num + *right_num;
-		else
-			reslt = *left_num - *right_num;
-	
-		if (verbose)
-			printf("%.*f %c %.*f = %.*f\n", 
-			f_prec, *left_num, opr->op, f_prec, *right_num, f_prec, reslt);
-			
-		*left_num = reslt;
-		nr->empty = true;
-		free(data);
+		rqueue_deq(&qs[AS_Q], &data);
+		emit_binary(ctx, (op_rec *)data);
+		pool_free(&ctx->pool, data);
 	}
-		
+
 	return;
 }
 
-static double * get_left_num(int curr_pos)
+static void emit_binary(Context * ctx, op_rec * opr)
 {
-	/* scan number array left for a non-empty entry */
-	
+	/* the result is saved in the left operand */
+	instr * ins = &ctx->curr_cexp->code[ctx->curr_cexp->n_code++];
+
+	ins->op = opr->op;
+	ins->rhs = opr->pos_right_num;
+	// find left operand
+	ins->dst = ins->lhs = get_left_num(ctx, opr->pos_right_num);
+	// mark the right operand as empty by linking it to its left neighbour
+	ctx->num_link[opr->pos_right_num] = opr->pos_right_num - 1;
+	return;
+}
+
+static int get_left_num(Context * ctx, int curr_pos)
+{
+	/* follow the links left to a non-empty entry, then point every
+	 * entry on the way straight at it, so it's found in one step next time;
+	 * this keeps long chains of operators from being quadratic */
+	int * link = ctx->num_link;
+	int found, next;
+
 	// decrement since curr_pos is pointing to the right operand
-	--curr_pos;
-	while (true == num_buff[curr_pos].empty)
-		--curr_pos;
-	
-	return &num_buff[curr_pos].num;
+	found = --curr_pos;
+	while (link[found] != found)
+		found = link[found];
+
+	while (link[curr_pos] != found)
+	{
+		next = link[curr_pos];
+		link[curr_pos] = found;
+		curr_pos = next;
+	}
+
+	return found;
 }
 
-static void push_op(Stack * s, op_rec * orc, int op)
+static void push_op(Context * ctx, VStack * s, op_rec * orc, int op)
 {
 	/* push operation and it's right operand position on the stack
      * here used only for exponentiation */
-	orc = make_op_rec();
+	bool grows;
+
+	if ( (orc = make_op_rec(ctx)) == NULL)
+		return;
 	orc->op = op;
-	orc->pos_right_num = nb_count + 1;
-	stack_push(s, (void *)orc);
+	orc->pos_right_num = ctx->nb_count + 1;
+	// a full stack reallocates its buffer
+	grows = (s->size == s->cap);
+	if (vstack_push(s, (void *)orc) != 0)
+		alloc_failed(ctx);
+	else if (grows)
+		++ctx->heap_calls;
 	return;
 }
 
-static void enq_op(Queue * q, op_rec * orc, int op)
+static void enq_op(Context * ctx, RQueue * q, op_rec * orc, int op)
 {
 	/* enqueue operation and save it's right operand position
 	 * used for left associative operators */
-	orc = make_op_rec();
+	bool grows;
+
+	if ( (orc = make_op_rec(ctx)) == NULL)
+		return;
 	orc->op = op;
-	orc->pos_right_num = nb_count + 1;
-	queue_enq(q, (void *)orc);
+	orc->pos_right_num = ctx->nb_count + 1;
+	// a full queue moves to a bigger buffer
+	grows = (q->size == q->cap);
+	if (rqueue_enq(q, (void *)orc) != 0)
+		alloc_failed(ctx);
+	else if (grows)
+		++ctx->heap_calls;
 	return;
 }
 
-static op_rec * make_op_rec(void)
+static op_rec * make_op_rec(Context * ctx)
 {
-	/* allocate memory for an operator record */
+	/* take an operator record from the pool */
 	op_rec * ret;
-	if ( (ret = malloc(sizeof(*ret))) == NULL)
+	if ( (ret = pool_alloc(&ctx->pool)) == NULL)
+		alloc_failed(ctx);
+	return ret;
+}
+
+static int comp_reserve(comp_expr * cexp, int n_nums, int n_code)
+{
+	/* grow to at least double the size */
+	double * new_nums;
+	instr * new_code;
+	comp_var * new_vars;
+	var_load * new_loads;
+	int new_size;
+
+	if (n_nums > cexp->nums_size)
 	{
-		fprintf(stderr, "Err: memory allocation failed\n");
-		exit(EXIT_FAILURE);
+		new_size = (cexp->nums_size * 2 > n_nums) ? cexp->nums_size * 2 : n_nums;
+		if ( (new_nums = realloc(cexp->nums, new_size * sizeof(*new_nums))) == NULL)
+			return -1;
+		cexp->nums = new_nums;
+		if ( (new_vars = realloc(cexp->vars, new_size * sizeof(*new_vars))) == NULL)
+			return -1;
+		cexp->vars = new_vars;
+		if ( (new_loads = realloc(cexp->loads, new_size * sizeof(*new_loads))) == NULL)
+			return -1;
+		cexp->loads = new_loads;
+		cexp->nums_size = new_size;
 	}
-	return ret;
+
+	if (n_code > cexp->code_size)
+	{
+		new_size = (cexp->code_size * 2 > n_code) ? cexp->code_size * 2 : n_code;
+		if ( (new_code = realloc(cexp->code, new_size * sizeof(*new_code))) == NULL)
+			return -1;
+		cexp->code = new_code;
+		cexp->code_size = new_size;
+	}
+
+	return 0;
+}
+
+static void add_load(Context * ctx, comp_expr * cexp, const char * name, int len, int slot)
+{
+	/* find the variable or make a new one */
+	var_load * ld;
+	int i;
+
+	for (i = 0; i < cexp->n_vars; ++i)
+	{
+		if (strncmp(cexp->vars[i].name, name, len) == 0 && '\0' == cexp->vars[i].name[len])
+			break;
+	}
+
+	if (cexp->n_vars == i)
+	{
+		if ( (cexp->vars[i].name = malloc(len + 1)) == NULL)
+		{
+			alloc_failed(ctx);
+			return;
+		}
+		memcpy(cexp->vars[i].name, name, len);
+		cexp->vars[i].name[len] = '\0';
+		cexp->vars[i].src = NULL;
+		++cexp->n_vars;
+	}
+
+	ld = &cexp->loads[cexp->n_loads++];
+	ld->slot = slot;
+	ld->var = i;
+	return;
+}
+
+static int alloc_failed(Context * ctx)
+{
+	/* at the token which needed the memory */
+	return err_set(ctx, ERR_MEMORY, ctx->buff_ptr - ctx->expr);
+}
+
+static double eval_failed(Context * ctx)
+{
+	/* nothing has been compiled, so there's no position */
+	errchk_start(ctx);
+	err_set(ctx, ERR_MEMORY, 0);
+	return NAN;
 }
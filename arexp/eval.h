@@ -3,13 +3,157 @@
 #ifndef EVAL_H_
 #define EVAL_H_
 
-// the decimal precision printed to the screen
-extern int f_prec;
+#include "context.h"
 
-double calculate(char * expr);
-/* 
-returns: the result of expr if expr contains a valid infix expression
+// a single operation of a compiled expression
+// the result of lhs op rhs is written in dst; unary minus uses rhs only
+typedef struct instr_ {
+	int op;
+	int dst;
+	int lhs;
+	int rhs;
+} instr;
 
-description: evaluates an infix expression
+// a variable of a compiled expression
+// the name is owned by the compiled expression; src is set by comp_bind()
+typedef struct comp_var_ {
+	char * name;
+	const double * src;
+} comp_var;
+
+// a variable loaded in a number slot before evaluation
+typedef struct var_load_ {
+	int slot;
+	int var;
+} var_load;
+
+// a compiled expression
+// the numbers are kept in slots; the operations are listed
+// in the order in which they have to be performed
+// every occurrence of a variable has a slot of its own, which is
+// filled from the variable before the operations are performed;
+// loads and vars have room for nums_size entries
+// native is the code made by jit.c, NULL if there's none; it lives in
+// native_mem, which is native_size bytes big
+// when optimized is set, orig has the operations as they were before opt.c
+// plan is made by par.c for evaluation on many threads, NULL if there's none
+typedef struct comp_expr_ {
+	int n_nums;
+	int n_code;
+	int result;
+	int nums_size;
+	int code_size;
+	double * nums;
+	instr * code;
+	int n_vars;
+	int n_loads;
+	comp_var * vars;
+	var_load * loads;
+	void (*native)(double * work);
+	void * native_mem;
+	size_t native_size;
+	bool optimized;
+	struct comp_expr_ * orig;
+	struct par_plan_ * plan;
+} comp_expr;
+
+void comp_init(comp_expr * cexp);
+/*
+returns: nothing
+
+description: Initializes cexp as an empty compiled expression. Must be called
+before cexp is passed to compile().
+*/
+
+void comp_destroy(comp_expr * cexp);
+/*
+returns: nothing
+
+description: Frees the memory held by cexp. cexp can be used again only after
+another call to comp_init().
+*/
+
+int compile(Context * ctx, comp_expr * cexp, const char * expr);
+/*
+returns: ERR_NONE on success, one of the error codes in context.h otherwise
+
+description: Checks expr and translates it into cexp, which can then be
+evaluated any number of times by evaluate(). Checking and parsing are done in
+a single pass over expr, which is not changed. The errors are those of
+errchk(), left in ctx; no numbers is ERR_NO_NUMBERS, and a failed allocation
+is ERR_MEMORY. Nothing is printed. Names become variables of cexp, bound with
+comp_bind(); a name used twice is one variable. When ctx->optimize is on, the
+operations are optimized by optimize(). When ctx->jit is on, they're also
+translated into native code, if that can be done on this machine. When
+ctx->par_threads is more than 1 and expr has PAR_MIN_CODE operations or more,
+par_compile() makes a plan for that many threads instead. The storage of cexp
+and ctx is sized from the length of expr up front and is kept between calls,
+so only memory limits the size of an expression. Operator records are taken
+from the pool of ctx, which is reset before returning, so once the pool has
+grown big enough for the expressions at hand ctx->pool.heap_calls stays the
+same. The operators wait to be recorded in queues and stacks which are arrays
+kept in ctx, so they stop growing as well; ctx->heap_calls counts the times
+they grew.
+*/
+
+void compile_destroy(Context * ctx);
+/*
+returns: nothing
+
+description: Frees what compile() keeps in ctx between calls. Called by
+context_destroy().
+*/
+
+int compile_len(Context * ctx, comp_expr * cexp, const char * expr, int len);
+/*
+returns: same as compile()
+
+description: Same as compile(), for the len characters at expr, which don't need
+to be followed by a '\0'. Lets an expression be compiled where it is, in the
+middle of a bigger text.
+*/
+
+int comp_bind(comp_expr * cexp, const char * name, const double * src);
+/*
+returns: 0 on success, -1 if there's no variable called name in cexp
+
+description: Binds the variable name of cexp to the array src. evaluate() reads
+src[0], evaluate_rows() reads as many elements as there are rows. The bindings
+are lost when cexp is compiled again.
+*/
+
+const char * comp_unbound(const comp_expr * cexp);
+/*
+returns: the name of the first variable of cexp which is not bound, NULL if
+all are bound
+
+description: Lets the callers which can't bind variables report them as errors.
+*/
+
+double evaluate(Context * ctx, const comp_expr * cexp);
+/*
+returns: the result of the expression compiled in cexp, NAN if a variable
+is not bound or memory runs out, which is ERR_MEMORY in ctx
+
+description: Performs the operations of a compiled expression in the work
+buffer of ctx, printing them if ctx->verbose is on. Otherwise native code or
+the plan of cexp, run by the threads of ctx, does the work when there is one.
+When tracing an optimized cexp, the operations as they were before optimization
+are performed, so what's printed doesn't change. Does no string processing,
+and no memory allocation unless the work buffer of ctx has never been as big
+as cexp needs. cexp is not changed, so it can be evaluated by many contexts
+at the same time.
+*/
+
+double calculate(Context * ctx, const char * expr);
+/*
+returns: the result of expr if expr contains a valid infix expression,
+NAN otherwise, with the error in ctx
+
+description: evaluates an infix expression; same as compile() followed by
+evaluate() with a compiled expression kept in ctx. When ctx->engine is
+ENGINE_PRATT, pratt_calc() does it instead, with the same result, unless
+verbose or keep_stats is on or expr has names; optimize, jit, and
+par_threads don't matter then.
 */
 #endif
@@ -0,0 +1,50 @@
+/* gen.c -- prints a corpus of random valid expressions */
+/* the corpus is the same for the same options on every machine,
+ * so it can be saved with the results it was used for */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "corpus.h"
+
+/* --------------- MAIN CODE --------------- */
+int main(int argc, char * argv[])
+{
+	/* read the options and print the corpus on stdout */
+	corpus_opts opts;
+	char * text;
+	size_t len;
+	int i;
+
+	corpus_defaults(&opts);
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-h") == 0)
+		{
+			printf("gen -- prints random valid expressions, one per line\n");
+			printf("\nSupported options:\n");
+			corpus_usage();
+			return 0;
+		}
+
+		switch (corpus_arg(&opts, argv[i]))
+		{
+			case 1:
+				break;
+			case -1:
+				fprintf(stderr, "Err: invalid value < %s >\n", argv[i]);
+				return 1;
+				break;
+			default:
+				fprintf(stderr, "Err: unknown option < %s >\n", argv[i]);
+				return 1;
+				break;
+		}
+	}
+
+	text = corpus_make(&opts, &len);
+	fwrite(text, 1, len, stdout);
+	free(text);
+
+	return 0;
+}
@@ -0,0 +1,188 @@
+/* jit.c -- translates compiled expressions into native code */
+/* works by writing a function which takes the work buffer in rdi and
+ * keeps it in rbx; every operation loads its left operand in xmm0, unless
+ * it's already there from the operation before, performs the operation with
+ * the right operand from memory, and stores xmm0 in the destination slot;
+ * the page is written while it's read/write only and is made executable
+ * after that, so it's never writable and executable at the same time */
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "errchk.h"
+#include "jit.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#define HAVE_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_JIT
+// the longest machine code of a single operation in bytes
+#define MAX_INSTR_BYTES	48
+
+// prologue and epilogue bytes
+#define FRAME_BYTES		16
+
+// an encoder position
+typedef struct code_buff_ {
+	unsigned char * pos;
+} code_buff;
+
+// writes len bytes
+static void put(code_buff * cb, const void * bytes, int len);
+
+// writes an SSE2 operation on xmm<reg> and [rbx + disp]
+static void put_mem_op(code_buff * cb, int prefix, int opcode, int reg, int32_t disp);
+
+// writes the code for one operation
+static void put_instr(code_buff * cb, const instr * ins, int * in_xmm0);
+#endif
+
+/* --------------- MAIN CODE --------------- */
+int jit_compile(comp_expr * cexp)
+{
+	/* write the function in a page of its own */
+#ifdef HAVE_JIT
+	static const unsigned char prologue[] = {
+		0x53,				// push rbx; aligns the stack for the call to pow()
+		0x48, 0x89, 0xFB,	// mov rbx, rdi
+	};
+	static const unsigned char epilogue[] = {
+		0x5B,				// pop rbx
+		0xC3,				// ret
+	};
+	code_buff cb;
+	const instr * ins, * end = cexp->code + cexp->n_code;
+	size_t size, page;
+	void * mem;
+	int in_xmm0 = -1;
+
+	cexp->native = NULL;
+
+	// slots are addressed with 32 bit displacements
+	if ((int64_t)cexp->n_nums * sizeof(double) > INT32_MAX)
+		return -1;
+
+	page = sysconf(_SC_PAGESIZE);
+	size = (size_t)cexp->n_code * MAX_INSTR_BYTES + FRAME_BYTES;
+	size = (size + page - 1) / page * page;
+
+	if (cexp->native_size >= size)
+	{
+		if (mprotect(cexp->native_mem, cexp->native_size, PROT_READ | PROT_WRITE) != 0)
+			return -1;
+	}
+	else
+	{
+		jit_release(cexp);
+		mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (MAP_FAILED == mem)
+			return -1;
+		cexp->native_mem = mem;
+		cexp->native_size = size;
+	}
+
+	cb.pos = cexp->native_mem;
+	put(&cb, prologue, sizeof(prologue));
+	for (ins = cexp->code; ins < end; ++ins)
+		put_instr(&cb, ins, &in_xmm0);
+	put(&cb, epilogue, sizeof(epilogue));
+
+	if (mprotect(cexp->native_mem, cexp->native_size, PROT_READ | PROT_EXEC) != 0)
+		return -1;
+
+	cexp->native = (void (*)(double *))cexp->native_mem;
+	return 0;
+#else
+	cexp->native = NULL;
+	return -1;
+#endif
+}
+
+void jit_release(comp_expr * cexp)
+{
+	/* give the page back */
+#ifdef HAVE_JIT
+	if (cexp->native_mem != NULL)
+		munmap(cexp->native_mem, cexp->native_size);
+#endif
+	cexp->native = NULL;
+	cexp->native_mem = NULL;
+	cexp->native_size = 0;
+	return;
+}
+
+#ifdef HAVE_JIT
+static void put_instr(code_buff * cb, const instr * ins, int * in_xmm0)
+{
+	/* xmm0 = [lhs]; xmm0 op= [rhs]; [dst] = xmm0 */
+	// mov rax, 1 << 63; movq xmm1, rax; xorpd xmm0, xmm1
+	static const unsigned char negate[] = {
+		0x48, 0xB8, 0, 0, 0, 0, 0, 0, 0, 0x80,
+		0x66, 0x48, 0x0F, 0x6E, 0xC8,
+		0x66, 0x0F, 0x57, 0xC1,
+	};
+	static const unsigned char call_rax[] = {0xFF, 0xD0};
+	static const unsigned char mov_rax[] = {0x48, 0xB8};
+	double (*pow_fn)(double, double) = pow;
+	uint64_t addr;
+	int opcode;
+
+	if (ins->lhs != *in_xmm0)
+		put_mem_op(cb, 0xF2, 0x10, 0, ins->lhs * sizeof(double));
+
+	switch (ins->op)
+	{
+		case UNARY_MINUS:
+			put(cb, negate, sizeof(negate));
+			break;
+		case '^':
+			// xmm0 and xmm1 are the arguments, xmm0 is the result
+			put_mem_op(cb, 0xF2, 0x10, 1, ins->rhs * sizeof(double));
+			addr = (uint64_t)(uintptr_t)pow_fn;
+			put(cb, mov_rax, sizeof(mov_rax));
+			put(cb, &addr, sizeof(addr));
+			put(cb, call_rax, sizeof(call_rax));
+			break;
+		default:
+			switch (ins->op)
+			{
+				case '+': opcode = 0x58; break;
+				case '*': opcode = 0x59; break;
+				case '-': opcode = 0x5C; break;
+				default: opcode = 0x5E; break;
+			}
+			put_mem_op(cb, 0xF2, opcode, 0, ins->rhs * sizeof(double));
+			break;
+	}
+
+	// movsd [dst], xmm0
+	put_mem_op(cb, 0xF2, 0x11, 0, ins->dst * sizeof(double));
+	*in_xmm0 = ins->dst;
+	return;
+}
+
+static void put_mem_op(code_buff * cb, int prefix, int opcode, int reg, int32_t disp)
+{
+	/* prefix 0F opcode, modrm with a 32 bit displacement from rbx */
+	unsigned char bytes[4];
+
+	bytes[0] = prefix;
+	bytes[1] = 0x0F;
+	bytes[2] = opcode;
+	bytes[3] = 0x80 | (reg << 3) | 0x03;
+	put(cb, bytes, sizeof(bytes));
+	put(cb, &disp, sizeof(disp));
+	return;
+}
+
+static void put(code_buff * cb, const void * bytes, int len)
+{
+	/* the page is big enough for the longest code */
+	memcpy(cb->pos, bytes, len);
+	cb->pos += len;
+	return;
+}
+#endif
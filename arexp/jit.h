@@ -0,0 +1,30 @@
+/* jit.h -- interface for jit.c */
+
+#ifndef JIT_H_
+#define JIT_H_
+
+#include "eval.h"
+
+int jit_compile(comp_expr * cexp);
+/*
+returns: 0 on success, -1 if native code can't be made here
+
+description: Translates the operations of cexp into x86-64 SSE2 machine code
+in an executable page and sets cexp->native to it. The code performs the
+operations on the work buffer passed to it, which must already hold the numbers
+and the values of the variables, and calls pow() for exponentiation. On other
+processors and systems nothing is done, so evaluate() goes on interpreting.
+The page is kept by cexp and reused by the next call when it's big enough.
+
+complexity: O(n)
+*/
+
+void jit_release(comp_expr * cexp);
+/*
+returns: nothing
+
+description: Unmaps the native code of cexp, if any.
+
+complexity: O(1)
+*/
+#endif
@@ -0,0 +1,105 @@
+/* numconv.c -- decimal string to double conversion */
+/* works by collecting the significant digits in a 64 bit integer and 
+ * counting the power of ten they have to be scaled by; if the digits fit 
+ * in a double exactly and the power is no more than 22, the power of ten 
+ * is exact too, and a single multiplication or division is correctly rounded 
+ * by the hardware; everything else is copied and given to strtod() */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "numconv.h"
+
+// the largest integer whose every predecessor is exact in a double
+#define MAX_EXACT	(UINT64_C(1) << 53)
+
+// no more digits than this are collected
+#define MAX_DIGITS	19
+
+// the largest exactly representable power of ten
+#define MAX_POW10	22
+
+// numbers no longer than this are copied on the stack for strtod()
+#define COPY_SIZE	64
+
+// is ch a decimal digit
+#define IS_DIGIT(ch)	((unsigned)((ch) - '0') < 10)
+
+// exact powers of ten
+static const double pow10_tab[MAX_POW10 + 1] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// converts the number with strtod()
+static double slow_path(const char * str, int len);
+
+/* --------------- MAIN CODE --------------- */
+double numconv(const char * str, const char * end, int * len)
+{
+	/* collect the digits and scale */
+	const char * pos = str;
+	uint64_t mant = 0;
+	int n_digits = 0, exp10 = 0;
+	bool truncated = false, frac = false;
+	
+	for (; pos < end; ++pos)
+	{
+		if ('.' == *pos && !frac)
+		{
+			frac = true;
+			continue;
+		}
+		if (!IS_DIGIT(*pos))
+			break;
+		
+		if (0 == mant && '0' == *pos)
+		{
+			// leading zeros aren't significant
+			if (frac)
+				--exp10;
+		}
+		else if (n_digits < MAX_DIGITS)
+		{
+			mant = mant * 10 + (*pos - '0');
+			++n_digits;
+			if (frac)
+				--exp10;
+		}
+		else
+		{
+			// digits which don't fit only change the scale
+			if (*pos != '0')
+				truncated = true;
+			if (!frac)
+				++exp10;
+		}
+	}
+	*len = pos - str;
+	
+	if (truncated || mant > MAX_EXACT || exp10 < -MAX_POW10 || exp10 > MAX_POW10)
+		return slow_path(str, *len);
+	
+	if (exp10 < 0)
+		return (double)mant / pow10_tab[-exp10];
+	return (double)mant * pow10_tab[exp10];
+}
+
+static double slow_path(const char * str, int len)
+{
+	/* strtod() needs a terminated string */
+	char copy[COPY_SIZE], * buff = copy;
+	double ret;
+	
+	if (len >= COPY_SIZE && (buff = malloc(len + 1)) == NULL)
+		return strtod(str, NULL);
+	
+	memcpy(buff, str, len);
+	buff[len] = '\0';
+	ret = strtod(buff, NULL);
+	
+	if (buff != copy)
+		free(buff);
+	return ret;
+}
@@ -0,0 +1,16 @@
+/* numconv.h -- interface for numconv.c */
+
+#ifndef NUMCONV_H_
+#define NUMCONV_H_
+
+double numconv(const char * str, const char * end, int * len);
+/*
+returns: the value of the decimal number at the beginning of str
+
+description: Reads digits, optionally followed by a decimal point and more digits, 
+never going past end. *len is set to the number of characters read. The result is 
+correctly rounded, the same as the one strtod() gives. Numbers of up to 15 significant 
+digits with small exponents are converted with one floating point operation; longer 
+ones are handed to strtod().
+*/
+#endif
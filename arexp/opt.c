@@ -0,0 +1,318 @@
+/* opt.c -- optimizes compiled expressions */
+/* works by numbering values: every slot starts out with a number or a
+ * variable in it, and every operation makes a value out of the values in
+ * its operand slots; values are kept in a hash table by operation and
+ * operands, so an operation seen before gives back the value it gave the
+ * first time, and an operation on numbers only is performed right away and
+ * gives a number; in the end only the values the result depends on are
+ * written out, each in a slot of its own, in the order they were made */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "errchk.h"
+#include "opt.h"
+
+// a value
+// op is NUMBER for numbers, NAME for variables, and the operator otherwise;
+// lhs is the variable of a NAME, lhs and rhs are the operand values of
+// an operation, rhs is -1 for unary minus; slot is -1 while the value isn't needed
+typedef struct val_node_ {
+	int op;
+	int lhs;
+	int rhs;
+	double num;
+	int slot;
+} val_node;
+
+// the work space of optimize(), kept in the context
+// nodes and slot_val have room for size entries, table for tbl_size
+struct opt_scratch_ {
+	int size;
+	int tbl_size;
+	int n_nodes;
+	val_node * nodes;
+	int * slot_val;
+	int * table;
+};
+
+// marks an empty table entry
+#define EMPTY	-1
+
+// makes sure the work space has room for size values
+static int scratch_reserve(Context * ctx, int size);
+
+// finds the value or makes a new one
+static int intern(struct opt_scratch_ * scr, int op, int lhs, int rhs, double num);
+
+// performs an operation on numbers, just like evaluate() does
+static double fold(int op, double lhs, double rhs);
+
+// copies the operations of cexp in cexp->orig
+static int keep_orig(comp_expr * cexp);
+
+/* --------------- MAIN CODE --------------- */
+int optimize(Context * ctx, comp_expr * cexp)
+{
+	/* number the values, then write out the needed ones */
+	struct opt_scratch_ * scr;
+	val_node * nd;
+	const instr * ins;
+	instr * out;
+	int i, lhs, rhs, val, result, n_slots;
+
+	// everything is allocated before cexp is touched
+	if (scratch_reserve(ctx, cexp->n_nums + cexp->n_code) != 0 || keep_orig(cexp) != 0)
+		return -1;
+	scr = ctx->opt;
+
+	// start over
+	scr->n_nodes = 0;
+	for (i = 0; i < scr->tbl_size; ++i)
+		scr->table[i] = EMPTY;
+
+	for (i = 0; i < cexp->n_nums; ++i)
+		scr->slot_val[i] = EMPTY;
+	for (i = 0; i < cexp->n_loads; ++i)
+		scr->slot_val[cexp->loads[i].slot] = intern(scr, NAME, cexp->loads[i].var, 0, 0.0);
+	for (i = 0; i < cexp->n_nums; ++i)
+	{
+		if (EMPTY == scr->slot_val[i])
+			scr->slot_val[i] = intern(scr, NUMBER, 0, 0, cexp->nums[i]);
+	}
+
+	for (ins = cexp->code; ins < cexp->code + cexp->n_code; ++ins)
+	{
+		rhs = scr->slot_val[ins->rhs];
+		lhs = (UNARY_MINUS == ins->op) ? rhs : scr->slot_val[ins->lhs];
+
+		if (NUMBER == scr->nodes[lhs].op && NUMBER == scr->nodes[rhs].op)
+		{
+			val = intern(scr, NUMBER, 0, 0,
+			fold(ins->op, scr->nodes[lhs].num, scr->nodes[rhs].num));
+		}
+		else if (UNARY_MINUS == ins->op)
+			val = intern(scr, ins->op, rhs, -1, 0.0);
+		else
+			val = intern(scr, ins->op, lhs, rhs, 0.0);
+
+		scr->slot_val[ins->dst] = val;
+	}
+	result = scr->slot_val[cexp->result];
+
+	// the operands of a value are made before it, so going down
+	// marks everything the result needs
+	scr->nodes[result].slot = 0;
+	for (i = result; i >= 0; --i)
+	{
+		nd = &scr->nodes[i];
+		if (nd->slot != EMPTY && nd->op != NUMBER && nd->op != NAME)
+		{
+			scr->nodes[nd->lhs].slot = 0;
+			if (nd->rhs != -1)
+				scr->nodes[nd->rhs].slot = 0;
+		}
+	}
+
+	n_slots = cexp->n_code = cexp->n_loads = 0;
+	for (i = 0; i <= result; ++i)
+	{
+		nd = &scr->nodes[i];
+		if (EMPTY == nd->slot)
+			continue;
+
+		nd->slot = n_slots++;
+		switch (nd->op)
+		{
+			case NUMBER:
+				cexp->nums[nd->slot] = nd->num;
+				break;
+			case NAME:
+				cexp->nums[nd->slot] = 0.0;
+				cexp->loads[cexp->n_loads].slot = nd->slot;
+				cexp->loads[cexp->n_loads].var = nd->lhs;
+				++cexp->n_loads;
+				break;
+			default:
+				out = &cexp->code[cexp->n_code++];
+				out->op = nd->op;
+				out->dst = nd->slot;
+				out->lhs = scr->nodes[nd->lhs].slot;
+				out->rhs = (nd->rhs != -1) ? scr->nodes[nd->rhs].slot : out->lhs;
+				break;
+		}
+	}
+
+	cexp->n_nums = n_slots;
+	cexp->result = scr->nodes[result].slot;
+	cexp->optimized = true;
+	return 0;
+}
+
+void opt_release(comp_expr * cexp)
+{
+	/* the variables belong to cexp */
+	if (cexp->orig != NULL)
+	{
+		free(cexp->orig->nums);
+		free(cexp->orig->code);
+		free(cexp->orig->loads);
+		free(cexp->orig);
+		cexp->orig = NULL;
+	}
+	cexp->optimized = false;
+	return;
+}
+
+void opt_destroy(Context * ctx)
+{
+	/* free the work space */
+	if (ctx->opt != NULL)
+	{
+		free(ctx->opt->nodes);
+		free(ctx->opt->slot_val);
+		free(ctx->opt->table);
+		free(ctx->opt);
+		ctx->opt = NULL;
+	}
+	return;
+}
+
+static int intern(struct opt_scratch_ * scr, int op, int lhs, int rhs, double num)
+{
+	/* open addressing with linear probing; numbers are the same when
+	 * their bits are, so 0 and -0 stay apart */
+	uint64_t bits, hash;
+	val_node * nd;
+	int i;
+
+	memcpy(&bits, &num, sizeof(bits));
+	hash = (NUMBER == op) ? bits : ((uint64_t)lhs << 32) ^ (uint32_t)rhs;
+	hash = (hash ^ (uint64_t)op) * 0x9E3779B97F4A7C15ULL;
+	i = (hash >> 32) & (scr->tbl_size - 1);
+
+	while (scr->table[i] != EMPTY)
+	{
+		nd = &scr->nodes[scr->table[i]];
+		if (nd->op == op)
+		{
+			if (NUMBER == op ? memcmp(&nd->num, &num, sizeof(num)) == 0
+				: (nd->lhs == lhs && nd->rhs == rhs))
+				return scr->table[i];
+		}
+		i = (i + 1) & (scr->tbl_size - 1);
+	}
+
+	nd = &scr->nodes[scr->n_nodes];
+	nd->op = op;
+	nd->lhs = lhs;
+	nd->rhs = rhs;
+	nd->num = num;
+	nd->slot = EMPTY;
+	scr->table[i] = scr->n_nodes;
+	return scr->n_nodes++;
+}
+
+static double fold(int op, double lhs, double rhs)
+{
+	/* the same expressions as in evaluate() */
+	switch (op)
+	{
+		case UNARY_MINUS:
+			return -rhs;
+		case '^':
+			return pow(lhs, rhs);
+		case '*':
+			return lhs * rhs;
+		case '/':
+			return lhs / rhs;
+		case '+':
+			return lhs + rhs;
+		default:
+			return lhs - rhs;
+	}
+}
+
+static int keep_orig(comp_expr * cexp)
+{
+	/* grow the copy to the size of cexp */
+	comp_expr * orig;
+
+	if (NULL == cexp->orig)
+	{
+		if ( (cexp->orig = calloc(1, sizeof(*cexp->orig))) == NULL)
+			return -1;
+	}
+	orig = cexp->orig;
+
+	if (orig->nums_size < cexp->nums_size)
+	{
+		free(orig->nums);
+		free(orig->loads);
+		orig->nums = malloc(cexp->nums_size * sizeof(*orig->nums));
+		orig->loads = malloc(cexp->nums_size * sizeof(*orig->loads));
+		orig->nums_size = 0;
+		if (NULL == orig->nums || NULL == orig->loads)
+			return -1;
+		orig->nums_size = cexp->nums_size;
+	}
+
+	if (orig->code_size < cexp->code_size)
+	{
+		free(orig->code);
+		orig->code_size = 0;
+		if ( (orig->code = malloc(cexp->code_size * sizeof(*orig->code))) == NULL)
+			return -1;
+		orig->code_size = cexp->code_size;
+	}
+
+	orig->n_nums = cexp->n_nums;
+	orig->n_code = cexp->n_code;
+	orig->n_loads = cexp->n_loads;
+	orig->result = cexp->result;
+	memcpy(orig->nums, cexp->nums, cexp->n_nums * sizeof(*orig->nums));
+	memcpy(orig->code, cexp->code, cexp->n_code * sizeof(*orig->code));
+	memcpy(orig->loads, cexp->loads, cexp->n_loads * sizeof(*orig->loads));
+
+	// the bindings are looked up through cexp, which has them
+	orig->n_vars = cexp->n_vars;
+	orig->vars = cexp->vars;
+	return 0;
+}
+
+static int scratch_reserve(Context * ctx, int size)
+{
+	/* grow to at least double the size; the table is kept at most half full */
+	struct opt_scratch_ * scr;
+	int new_size;
+
+	if (NULL == ctx->opt)
+	{
+		if ( (ctx->opt = calloc(1, sizeof(*ctx->opt))) == NULL)
+			return -1;
+	}
+	scr = ctx->opt;
+
+	if (size <= scr->size)
+		return 0;
+
+	new_size = (scr->size * 2 > size) ? scr->size * 2 : size;
+	free(scr->nodes);
+	free(scr->slot_val);
+	free(scr->table);
+
+	scr->tbl_size = 1;
+	while (scr->tbl_size < 2 * new_size)
+		scr->tbl_size *= 2;
+
+	scr->nodes = malloc(new_size * sizeof(*scr->nodes));
+	scr->slot_val = malloc(new_size * sizeof(*scr->slot_val));
+	scr->table = malloc(scr->tbl_size * sizeof(*scr->table));
+	scr->size = 0;
+	if (NULL == scr->nodes || NULL == scr->slot_val || NULL == scr->table)
+		return -1;
+	scr->size = new_size;
+
+	return 0;
+}
@@ -0,0 +1,42 @@
+/* opt.h -- interface for opt.c */
+
+#ifndef OPT_H_
+#define OPT_H_
+
+#include "context.h"
+#include "eval.h"
+
+int optimize(Context * ctx, comp_expr * cexp);
+/*
+returns: 0 on success, -1 if memory can't be allocated, in which case cexp
+is not changed
+
+description: Rewrites the operations of cexp so that operations on numbers only
+are performed once, here, and operations which are the same as one before them,
+on the same operands, are performed only once as well. Operations the result
+doesn't depend on are dropped. The results are the same to the bit. The
+operations as they were are kept in cexp->orig for evaluate() to print when
+ctx->verbose is on. cexp must have room for as many numbers as it has numbers
+and operations together.
+
+complexity: O(n)
+*/
+
+void opt_release(comp_expr * cexp);
+/*
+returns: nothing
+
+description: Frees the copy of the operations kept by optimize() in cexp.
+
+complexity: O(1)
+*/
+
+void opt_destroy(Context * ctx);
+/*
+returns: nothing
+
+description: Frees the work space of optimize() in ctx.
+
+complexity: O(1)
+*/
+#endif
@@ -0,0 +1,713 @@
+/* par.c -- evaluation of huge expressions on many threads */
+/* every operation of a compiled expression writes its result over its left
+ * operand, so the operations which write the same slot make a chain, and the
+ * right operand of a binary operation is the last value written in another
+ * slot; the operations are a tree, which par_compile() cuts into tasks of
+ * about TASK_SIZE operations, each of which waits only for the tasks below it;
+ * par_run() gives the tasks to a pool of threads, each with a deque of the
+ * tasks which are ready; a thread takes the newest task of its own deque and,
+ * when there's none, steals the oldest task of another; a finished task makes
+ * the task above it ready when it's the last one that task waits for
+ * a long chain of additions is a single line of tasks, each waiting for the
+ * one before, so before the cuts it's split into pieces of about TASK_SIZE
+ * operations; every piece is summed up on its own, in the slot of its first
+ * operand, and the sums are added to the chain in order at its end;
+ * subtraction is addition of the negated operand, which is the same to the
+ * bit; chains of multiplications are split the same way */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "errchk.h"
+#include "par.h"
+
+// operations per task, and per piece of a chain
+#define TASK_SIZE	2048
+
+// marks no operation or no task
+#define NONE		-1
+
+// flags of the operations of a split chain
+#define SEG_FIRST	1	// the first of its piece
+#define SEG_END		2	// the last of the chain
+
+// the chains which can be split
+enum {
+	CH_NONE,
+	CH_ADD,	// additions and subtractions
+	CH_MUL	// multiplications
+};
+
+/* structure for a task
+ * the operations from start to end of the plan; parent is the task which waits
+ * for this one, NONE for the one with the result; n_deps is how many it waits for */
+typedef struct par_task_ {
+	int start;
+	int end;
+	int parent;
+	int n_deps;
+} par_task;
+
+/* structure for a plan
+ * the operations grouped by task, in the order of the tasks; a task comes
+ * after all the tasks it waits for, so the code in order is the whole
+ * expression; ready lists the tasks which wait for none */
+typedef struct par_plan_ {
+	instr * code;
+	int n_code;
+	par_task * tasks;
+	int n_tasks;
+	int * ready;
+	int n_ready;
+} par_plan;
+
+/* structure for a deque of ready tasks
+ * the owner pushes and pops at the bottom, the thieves take from the top */
+typedef struct deque_ {
+	pthread_mutex_t lock;
+	int * tasks;
+	int top;
+	int bottom;
+} deque;
+
+struct par_pool_;
+
+/* structure for what a thread is given */
+typedef struct worker_arg_ {
+	struct par_pool_ * pool;
+	int id;
+} worker_arg;
+
+/* structure for the pool
+ * the calling thread is worker 0 and the started threads are the rest; every
+ * deque and pending have room for tasks_size tasks; pending counts the tasks
+ * every task still waits for, and queued the tasks in the deques, so a thread
+ * which has nothing to do can sleep until there's something; job is bumped for
+ * every plan performed, and busy counts the threads which haven't finished with it */
+typedef struct par_pool_ {
+	int n_workers;
+	pthread_t * threads;
+	worker_arg * args;
+	deque * deques;
+	int * pending;
+	int tasks_size;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t finish;
+	pthread_cond_t has_work;
+	long job;
+	int busy;
+	int queued;
+	bool done;
+	bool quit;
+	const par_plan * plan;
+	double * work;
+} par_pool;
+
+// finds the operations which wrote the operands of every operation
+static void link_ops(const instr * code, int n_code, int * last, int n_nums,
+	int * left, int * right);
+
+// the kind of chain op belongs to
+static int chain_kind(int op);
+
+// performs the operations from ins to end on work
+static void exec(double * work, const instr * ins, const instr * end);
+
+// makes the pool of ctx, or a new one for a new number of threads; NULL on failure
+static par_pool * get_pool(Context * ctx, int n_tasks);
+
+// takes a task for worker id, its own or another's; NONE if there's none
+static int take(par_pool * pool, int id);
+
+// performs tasks until the one with the result is done
+static void work_on(par_pool * pool, int id);
+
+// the started threads wait for plans here
+static void * worker(void * arg);
+
+/* --------------- MAIN CODE --------------- */
+int par_compile(comp_expr * cexp)
+{
+	/* split the chains, then cut the tree into tasks */
+	int * last, * left, * right, * size, * next, * seg, * run_seg, * seg_slot;
+	int * parent, * task_of;
+	char * flags;
+	par_plan * plan;
+	par_task * tsk;
+	instr * out, * ins;
+	int i, j, k, n, m, kind, n_segs, n_roots, weight, acc, p;
+	bool new_seg;
+
+	par_release(cexp);
+	n = cexp->n_code;
+	if (n < PAR_MIN_CODE)
+		return -1;
+
+	last = malloc(cexp->n_nums * sizeof(*last));
+	left = malloc(n * sizeof(*left));
+	right = malloc(n * sizeof(*right));
+	size = malloc(n * sizeof(*size));
+	next = malloc(n * sizeof(*next));
+	seg = malloc(n * sizeof(*seg));
+	run_seg = malloc(n * sizeof(*run_seg));
+	seg_slot = malloc(n * sizeof(*seg_slot));
+	flags = calloc(n, sizeof(*flags));
+	plan = calloc(1, sizeof(*plan));
+	if (!last || !left || !right || !size || !next || !seg || !run_seg ||
+		!seg_slot || !flags || !plan)
+		goto fail;
+
+	// the size of every subtree, and the next operation on the same slot
+	link_ops(cexp->code, n, last, cexp->n_nums, left, right);
+	for (i = 0; i < n; ++i)
+	{
+		next[i] = seg[i] = NONE;
+		size[i] = 1;
+		if (left[i] != NONE)
+		{
+			size[i] += size[left[i]];
+			next[left[i]] = i;
+		}
+		if (right[i] != NONE)
+			size[i] += size[right[i]];
+	}
+
+	// a chain begins with an operation whose left operand was written by
+	// one of another kind; it's split when it makes at least two pieces
+	n_segs = 0;
+	for (i = 0; i < n; ++i)
+	{
+		if ( (kind = chain_kind(cexp->code[i].op)) == CH_NONE ||
+			(left[i] != NONE && chain_kind(cexp->code[left[i]].op) == kind) )
+			continue;
+
+		weight = 0;
+		for (j = i; j != NONE && chain_kind(cexp->code[j].op) == kind; j = next[j])
+			weight += 1 + ((right[j] != NONE) ? size[right[j]] : 0);
+		if (weight < 2 * TASK_SIZE)
+			continue;
+
+		k = n_segs;
+		p = i;
+		acc = 0;
+		new_seg = true;
+		for (j = i; j != NONE && chain_kind(cexp->code[j].op) == kind; j = next[j])
+		{
+			if (new_seg)
+			{
+				seg_slot[n_segs++] = cexp->code[j].rhs;
+				flags[j] |= SEG_FIRST;
+				new_seg = false;
+				acc = 0;
+			}
+			seg[j] = n_segs - 1;
+			acc += 1 + ((right[j] != NONE) ? size[right[j]] : 0);
+			if (acc >= TASK_SIZE)
+				new_seg = true;
+			p = j;
+		}
+		flags[p] |= SEG_END;
+		run_seg[p] = k;
+	}
+
+	// every piece is computed in the slot of its first operand, and the
+	// pieces are combined when the chain ends
+	if ( (out = malloc((n + 2 * n_segs) * sizeof(*out))) == NULL)
+		goto fail;
+	plan->code = out;
+	for (i = m = 0; i < n; ++i)
+	{
+		ins = &cexp->code[i];
+		if (NONE == seg[i])
+		{
+			out[m++] = *ins;
+			continue;
+		}
+
+		p = seg_slot[seg[i]];
+		if (!(flags[i] & SEG_FIRST))
+		{
+			out[m].op = ins->op;
+			out[m].dst = out[m].lhs = p;
+			out[m++].rhs = ins->rhs;
+		}
+		else if ('-' == ins->op)
+		{
+			out[m].op = UNARY_MINUS;
+			out[m].dst = out[m].lhs = out[m].rhs = p;
+			++m;
+		}
+
+		if (flags[i] & SEG_END)
+		{
+			for (k = run_seg[i]; k <= seg[i]; ++k)
+			{
+				out[m].op = (chain_kind(ins->op) == CH_ADD) ? '+' : '*';
+				out[m].dst = out[m].lhs = ins->dst;
+				out[m++].rhs = seg_slot[k];
+			}
+		}
+	}
+	plan->n_code = m;
+	free(left);
+	free(right);
+	free(size);
+	free(next);
+	free(seg);
+	free(run_seg);
+	free(seg_slot);
+	free(flags);
+	seg = run_seg = seg_slot = NULL;
+
+	// the same for the new code
+	left = malloc(m * sizeof(*left));
+	right = malloc(m * sizeof(*right));
+	size = malloc(m * sizeof(*size));
+	next = malloc(m * sizeof(*next));
+	flags = malloc(m * sizeof(*flags));
+	if (!left || !right || !size || !next || !flags)
+		goto fail;
+	parent = next;
+	link_ops(out, m, last, cexp->n_nums, left, right);
+
+	// everything but the result has a parent, or the code isn't a tree
+	for (i = 0; i < m; ++i)
+		parent[i] = NONE;
+	for (i = 0; i < m; ++i)
+	{
+		if (left[i] != NONE)
+			parent[left[i]] = i;
+		if (right[i] != NONE)
+			parent[right[i]] = i;
+	}
+	for (i = n_roots = 0; i < m; ++i)
+		n_roots += (NONE == parent[i]);
+	if (n_roots != 1 || parent[m - 1] != NONE)
+		goto fail;
+
+	// a task ends where the operations not yet in a task reach TASK_SIZE;
+	// size is what's not in a task below the operation
+	for (i = 0, plan->n_tasks = 0; i < m; ++i)
+	{
+		size[i] = 1;
+		if (left[i] != NONE && !flags[left[i]])
+			size[i] += size[left[i]];
+		if (right[i] != NONE && !flags[right[i]])
+			size[i] += size[right[i]];
+		flags[i] = (size[i] >= TASK_SIZE || m - 1 == i);
+		plan->n_tasks += flags[i];
+	}
+	if (plan->n_tasks < 2)
+		goto fail;
+
+	if ( (plan->tasks = calloc(plan->n_tasks, sizeof(*plan->tasks))) == NULL ||
+		(plan->ready = malloc(plan->n_tasks * sizeof(*plan->ready))) == NULL ||
+		(plan->code = malloc(m * sizeof(*plan->code))) == NULL)
+	{
+		plan->code = out;
+		goto fail;
+	}
+
+	// the task of an operation is that of its parent, unless it ends one;
+	// the tasks are numbered in the order in which they end
+	task_of = left;
+	for (i = m - 1, k = plan->n_tasks; i >= 0; --i)
+		task_of[i] = flags[i] ? --k : task_of[parent[i]];
+	for (i = 0; i < m; ++i)
+	{
+		tsk = &plan->tasks[task_of[i]];
+		++tsk->end;
+		if (flags[i])
+		{
+			tsk->parent = (parent[i] != NONE) ? task_of[parent[i]] : NONE;
+			if (tsk->parent != NONE)
+				++plan->tasks[tsk->parent].n_deps;
+		}
+	}
+
+	// the operations of a task are kept in order
+	for (k = acc = 0; k < plan->n_tasks; ++k)
+	{
+		tsk = &plan->tasks[k];
+		tsk->start = acc;
+		acc += tsk->end;
+		tsk->end = tsk->start;
+		if (0 == tsk->n_deps)
+			plan->ready[plan->n_ready++] = k;
+	}
+	for (i = 0; i < m; ++i)
+		plan->code[plan->tasks[task_of[i]].end++] = out[i];
+
+	free(out);
+	free(last);
+	free(left);
+	free(right);
+	free(size);
+	free(next);
+	free(flags);
+	cexp->plan = plan;
+	return 0;
+
+fail:
+	free(last);
+	free(left);
+	free(right);
+	free(size);
+	free(next);
+	free(seg);
+	free(run_seg);
+	free(seg_slot);
+	free(flags);
+	if (plan != NULL)
+	{
+		free(plan->code);
+		free(plan->tasks);
+		free(plan->ready);
+		free(plan);
+	}
+	return -1;
+}
+
+void par_run(Context * ctx, double * work, const comp_expr * cexp)
+{
+	/* deal out the ready tasks, wake the threads, and join them */
+	const par_plan * plan = cexp->plan;
+	par_pool * pool;
+	deque * dq;
+	int i;
+
+	if ( (pool = get_pool(ctx, plan->n_tasks)) == NULL)
+	{
+		exec(work, plan->code, plan->code + plan->n_code);
+		return;
+	}
+
+	for (i = 0; i < pool->n_workers; ++i)
+		pool->deques[i].top = pool->deques[i].bottom = 0;
+	for (i = 0; i < plan->n_tasks; ++i)
+		pool->pending[i] = plan->tasks[i].n_deps;
+	for (i = 0; i < plan->n_ready; ++i)
+	{
+		dq = &pool->deques[i % pool->n_workers];
+		dq->tasks[dq->bottom++] = plan->ready[i];
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->plan = plan;
+	pool->work = work;
+	pool->done = false;
+	pool->queued = plan->n_ready;
+	pool->busy = pool->n_workers - 1;
+	++pool->job;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	work_on(pool, 0);
+
+	// nobody touches work after this
+	pthread_mutex_lock(&pool->lock);
+	while (pool->busy > 0)
+		pthread_cond_wait(&pool->finish, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+	return;
+}
+
+void par_release(comp_expr * cexp)
+{
+	/* the plan and everything in it */
+	par_plan * plan = cexp->plan;
+
+	if (NULL == plan)
+		return;
+
+	free(plan->code);
+	free(plan->tasks);
+	free(plan->ready);
+	free(plan);
+	cexp->plan = NULL;
+	return;
+}
+
+void par_destroy(Context * ctx)
+{
+	/* tell the threads to quit and wait for them */
+	par_pool * pool = ctx->par;
+	int i;
+
+	if (NULL == pool)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for (i = 1; i < pool->n_workers; ++i)
+		pthread_join(pool->threads[i], NULL);
+
+	for (i = 0; i < pool->n_workers; ++i)
+	{
+		pthread_mutex_destroy(&pool->deques[i].lock);
+		free(pool->deques[i].tasks);
+	}
+	pthread_cond_destroy(&pool->has_work);
+	pthread_cond_destroy(&pool->finish);
+	pthread_cond_destroy(&pool->start);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->pending);
+	free(pool->deques);
+	free(pool->args);
+	free(pool->threads);
+	free(pool);
+	ctx->par = NULL;
+	return;
+}
+
+static void link_ops(const instr * code, int n_code, int * last, int n_nums,
+	int * left, int * right)
+{
+	/* unary minus has only the right operand, which is also its left */
+	int i;
+
+	for (i = 0; i < n_nums; ++i)
+		last[i] = NONE;
+
+	for (i = 0; i < n_code; ++i)
+	{
+		left[i] = last[code[i].lhs];
+		right[i] = (UNARY_MINUS == code[i].op) ? NONE : last[code[i].rhs];
+		last[code[i].dst] = i;
+	}
+
+	return;
+}
+
+static int chain_kind(int op)
+{
+	/* division doesn't split */
+	switch (op)
+	{
+		case '+':
+		case '-':
+			return CH_ADD;
+			break;
+		case '*':
+			return CH_MUL;
+			break;
+		default:
+			break;
+	}
+
+	return CH_NONE;
+}
+
+static void exec(double * work, const instr * ins, const instr * end)
+{
+	/* same as run() in eval.c */
+	for (; ins < end; ++ins)
+	{
+		switch (ins->op)
+		{
+			case UNARY_MINUS:
+				work[ins->dst] = -work[ins->rhs];
+				break;
+			case '^':
+				work[ins->dst] = pow(work[ins->lhs], work[ins->rhs]);
+				break;
+			case '*':
+				work[ins->dst] = work[ins->lhs] * work[ins->rhs];
+				break;
+			case '/':
+				work[ins->dst] = work[ins->lhs] / work[ins->rhs];
+				break;
+			case '+':
+				work[ins->dst] = work[ins->lhs] + work[ins->rhs];
+				break;
+			default:
+				work[ins->dst] = work[ins->lhs] - work[ins->rhs];
+				break;
+		}
+	}
+
+	return;
+}
+
+static par_pool * get_pool(Context * ctx, int n_tasks)
+{
+	/* the threads are started once; the deques grow with the plans */
+	par_pool * pool = ctx->par;
+	int * new_tasks;
+	int i, n = ctx->par_threads;
+
+	if (pool != NULL && pool->n_workers != n)
+	{
+		par_destroy(ctx);
+		pool = NULL;
+	}
+
+	if (NULL == pool)
+	{
+		if ( (pool = calloc(1, sizeof(*pool))) == NULL)
+			return NULL;
+		if ( (pool->threads = malloc(n * sizeof(*pool->threads))) == NULL ||
+			(pool->args = malloc(n * sizeof(*pool->args))) == NULL ||
+			(pool->deques = calloc(n, sizeof(*pool->deques))) == NULL)
+		{
+			free(pool->threads);
+			free(pool->args);
+			free(pool);
+			return NULL;
+		}
+
+		pthread_mutex_init(&pool->lock, NULL);
+		pthread_cond_init(&pool->start, NULL);
+		pthread_cond_init(&pool->finish, NULL);
+		pthread_cond_init(&pool->has_work, NULL);
+		for (i = 0; i < n; ++i)
+		{
+			pthread_mutex_init(&pool->deques[i].lock, NULL);
+			pool->args[i].pool = pool;
+			pool->args[i].id = i;
+		}
+
+		// the threads which did start are stopped by par_destroy()
+		ctx->par = pool;
+		for (pool->n_workers = 1; pool->n_workers < n; ++pool->n_workers)
+		{
+			i = pool->n_workers;
+			if (pthread_create(&pool->threads[i], NULL, worker, &pool->args[i]) != 0)
+			{
+				for (; i < n; ++i)
+					pthread_mutex_destroy(&pool->deques[i].lock);
+				par_destroy(ctx);
+				return NULL;
+			}
+		}
+	}
+
+	if (n_tasks > pool->tasks_size)
+	{
+		for (i = 0; i < pool->n_workers; ++i)
+		{
+			if ( (new_tasks = realloc(pool->deques[i].tasks,
+				n_tasks * sizeof(*new_tasks))) == NULL)
+				return NULL;
+			pool->deques[i].tasks = new_tasks;
+		}
+		if ( (new_tasks = realloc(pool->pending, n_tasks * sizeof(*new_tasks))) == NULL)
+			return NULL;
+		pool->pending = new_tasks;
+		pool->tasks_size = n_tasks;
+	}
+
+	return pool;
+}
+
+static int take(par_pool * pool, int id)
+{
+	/* the newest of its own, so the task above is likely still in the cache,
+	 * or the oldest of the next deque which has one */
+	deque * dq;
+	int i, t = NONE;
+
+	dq = &pool->deques[id];
+	pthread_mutex_lock(&dq->lock);
+	if (dq->bottom > dq->top)
+		t = dq->tasks[--dq->bottom];
+	pthread_mutex_unlock(&dq->lock);
+
+	for (i = 1; NONE == t && i < pool->n_workers; ++i)
+	{
+		dq = &pool->deques[(id + i) % pool->n_workers];
+		pthread_mutex_lock(&dq->lock);
+		if (dq->bottom > dq->top)
+			t = dq->tasks[dq->top++];
+		pthread_mutex_unlock(&dq->lock);
+	}
+
+	return t;
+}
+
+static void work_on(par_pool * pool, int id)
+{
+	/* the locks order the writes to work of a task before its parent's reads */
+	const par_plan * plan = pool->plan;
+	const par_task * tsk;
+	deque * dq = &pool->deques[id];
+	int t;
+
+	while (true)
+	{
+		t = take(pool, id);
+
+		pthread_mutex_lock(&pool->lock);
+		if (NONE == t)
+		{
+			// sleep until a task is pushed or the result is done
+			while (!pool->done && 0 == pool->queued)
+				pthread_cond_wait(&pool->has_work, &pool->lock);
+			if (pool->done)
+			{
+				pthread_mutex_unlock(&pool->lock);
+				break;
+			}
+			pthread_mutex_unlock(&pool->lock);
+			continue;
+		}
+		--pool->queued;
+		pthread_mutex_unlock(&pool->lock);
+
+		tsk = &plan->tasks[t];
+		exec(pool->work, plan->code + tsk->start, plan->code + tsk->end);
+
+		pthread_mutex_lock(&pool->lock);
+		if (NONE == tsk->parent)
+		{
+			pool->done = true;
+			pthread_cond_broadcast(&pool->has_work);
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		if (--pool->pending[tsk->parent] == 0)
+		{
+			pthread_mutex_lock(&dq->lock);
+			dq->tasks[dq->bottom++] = tsk->parent;
+			pthread_mutex_unlock(&dq->lock);
+			++pool->queued;
+			pthread_cond_signal(&pool->has_work);
+		}
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return;
+}
+
+static void * worker(void * arg)
+{
+	/* one plan after another, until par_destroy() */
+	worker_arg * wa = (worker_arg *)arg;
+	par_pool * pool = wa->pool;
+	long seen = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	while (true)
+	{
+		while (pool->job == seen && !pool->quit)
+			pthread_cond_wait(&pool->start, &pool->lock);
+		if (pool->quit)
+			break;
+		seen = pool->job;
+		pthread_mutex_unlock(&pool->lock);
+
+		work_on(pool, wa->id);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->busy == 0)
+			pthread_cond_signal(&pool->finish);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
@@ -0,0 +1,60 @@
+/* par.h -- interface for par.c */
+
+#ifndef PAR_H_
+#define PAR_H_
+
+#include "context.h"
+#include "eval.h"
+
+// expressions with fewer operations are always evaluated on one thread
+#define PAR_MIN_CODE	(1 << 15)
+
+int par_compile(comp_expr * cexp);
+/*
+returns: 0 on success, -1 if cexp is too small to gain anything from threads,
+or if memory can't be allocated
+
+description: Makes a plan for evaluating cexp on many threads and keeps it in
+cexp->plan. The operations are cut into tasks of a few thousand operations each;
+independent parts of the expression are independent tasks, and long chains of
+additions, subtractions, or multiplications are split into pieces which are
+summed, or multiplied, on their own and then combined from left to right. The
+pieces depend only on the expression, so the result is the same for any number
+of threads, but a split chain can differ in the last digits from the result on
+one thread. cexp must not be optimized.
+
+complexity: O(n)
+*/
+
+void par_run(Context * ctx, double * work, const comp_expr * cexp);
+/*
+returns: nothing
+
+description: Performs the plan of cexp on work, which must already hold the
+numbers and the values of the variables, with ctx->par_threads threads, the
+calling one included. The threads are started by the first call and kept in ctx
+for the next ones; every thread has its own queue of tasks which are ready, and
+one which runs out takes tasks from the others. When the threads can't be
+started the plan is performed on the calling thread.
+
+complexity: O(n)
+*/
+
+void par_release(comp_expr * cexp);
+/*
+returns: nothing
+
+description: Frees the plan of cexp, if any.
+
+complexity: O(1)
+*/
+
+void par_destroy(Context * ctx);
+/*
+returns: nothing
+
+description: Stops the threads of ctx, if any, and frees their memory.
+
+complexity: O(n)
+*/
+#endif
@@ -0,0 +1,299 @@
+/* pcheck.c -- checks huge expressions on many threads */
+/* works by cutting the expression in pieces at characters which are tokens
+ * of their own and are never translated, one of ()*^/, so a piece never reads
+ * what another one writes: a + or - is unary or not depending on the character
+ * before it, which is in the same piece, and the character after the last
+ * token of a piece is never changed; the depth of parentheses at the start of
+ * every piece is the sum of the opening less the closing ones of the pieces
+ * before it, which are counted with SIMD compare instructions, along with the
+ * + and - characters, which bound the number of unary operators; the pieces
+ * are then checked at the same time, each keeping a list of the operators it
+ * translated; the first piece with an error has the error errchk() would have
+ * found, and the pieces after it are translated back, since errchk() would
+ * have stopped before them */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "errchk.h"
+#include "pcheck.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2
+#endif
+#endif
+
+// the most pieces an expression is cut in
+#define MAX_PIECES	64
+
+// the characters a piece can begin with
+#define CUT_CHARS	"()*/^"
+
+/* structure for a piece of the expression
+ * the piece is from start to stop; depth is the open parentheses before it,
+ * and signs is the number of + and - in it, which is the room in unary for
+ * the offsets of the translated operators; ctx has the first error of the piece */
+typedef struct piece_ {
+	char * expr;
+	char * start;
+	char * stop;
+	char * end;
+	int depth;
+	long signs;
+	long * unary;
+	long n_unary;
+	Context ctx;
+} piece;
+
+// counts the opening and closing parentheses and the + and - in n characters
+typedef void (*scan_fn)(const char * s, long n, long * opens, long * closes, long * signs);
+
+// one character at a time
+static void scan_scalar(const char * s, long n, long * opens, long * closes, long * signs);
+
+#ifdef HAVE_SSE2
+// sixteen characters at a time
+static void scan_sse2(const char * s, long n, long * opens, long * closes, long * signs);
+#endif
+
+#ifdef HAVE_AVX2
+// thirty two characters at a time
+static void scan_avx2(const char * s, long n, long * opens, long * closes, long * signs)
+	__attribute__((target("avx2")));
+#endif
+
+// the best scanner for this processor and its name
+static scan_fn pick_scan(const char ** name);
+
+// checks a piece like errchk() does
+static void * check_piece(void * arg);
+
+/* --------------- MAIN CODE --------------- */
+int errchk_par(Context * ctx, char * expr, int n_threads)
+{
+	/* cut, count, check, and pick the first error */
+	pthread_t threads[MAX_PIECES];
+	bool started[MAX_PIECES];
+	const char * name;
+	scan_fn scan = pick_scan(&name);
+	piece * pieces;
+	char * end, * cut;
+	long len, opens, closes;
+	int i, n_pieces, first, depth;
+
+	len = strlen(expr);
+	end = expr + len;
+	if (n_threads > MAX_PIECES)
+		n_threads = MAX_PIECES;
+	if (n_threads < 2 || len < PCHECK_MIN_LEN ||
+		(pieces = malloc(n_threads * sizeof(*pieces))) == NULL)
+		return errchk(ctx, expr);
+
+	// every piece but the first begins at the first cut character after
+	// its share of the expression; a piece without one is part of the one before
+	pieces[0].start = expr;
+	for (i = 1, n_pieces = 1; i < n_threads; ++i)
+	{
+		cut = expr + len / n_threads * i;
+		if (cut <= pieces[n_pieces - 1].start)
+			continue;
+		while (cut < end && strchr(CUT_CHARS, *cut) == NULL)
+			++cut;
+		if (cut < end)
+			pieces[n_pieces++].start = cut;
+	}
+	if (1 == n_pieces)
+	{
+		free(pieces);
+		return errchk(ctx, expr);
+	}
+
+	// the depth at the start of every piece is the sum of those before
+	for (i = 0, depth = 0; i < n_pieces; ++i)
+	{
+		pieces[i].expr = expr;
+		pieces[i].end = end;
+		pieces[i].stop = (i + 1 < n_pieces) ? pieces[i + 1].start : end;
+		pieces[i].depth = depth;
+		pieces[i].n_unary = 0;
+		scan(pieces[i].start, pieces[i].stop - pieces[i].start, &opens, &closes, &pieces[i].signs);
+		depth += opens - closes;
+
+		// nothing has been changed yet, so one thread can still do it all
+		if ( (pieces[i].unary = malloc((pieces[i].signs + 1) * sizeof(long))) == NULL)
+		{
+			while (--i >= 0)
+				free(pieces[i].unary);
+			free(pieces);
+			return errchk(ctx, expr);
+		}
+	}
+
+	// a piece for which there's no thread is checked by this one
+	for (i = 1; i < n_pieces; ++i)
+		started[i] = (pthread_create(&threads[i], NULL, check_piece, &pieces[i]) == 0);
+	check_piece(&pieces[0]);
+	for (i = 1; i < n_pieces; ++i)
+	{
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			check_piece(&pieces[i]);
+	}
+
+	for (first = 0; first < n_pieces; ++first)
+	{
+		if (pieces[first].ctx.err_code != ERR_NONE)
+			break;
+	}
+
+	// errchk() would have stopped at the first error
+	errchk_start(ctx);
+	for (i = first + 1; i < n_pieces; ++i)
+	{
+		while (pieces[i].n_unary > 0)
+		{
+			cut = expr + pieces[i].unary[--pieces[i].n_unary];
+			*cut = (UNARY_MINUS == *cut) ? '-' : '+';
+		}
+	}
+	if (first < n_pieces)
+	{
+		ctx->err_code = pieces[first].ctx.err_code;
+		ctx->err_pos = pieces[first].ctx.err_pos;
+		ctx->err_char = pieces[first].ctx.err_char;
+		ctx->err_next = pieces[first].ctx.err_next;
+		ctx->err_list = pieces[first].ctx.err_list;
+	}
+	else
+		errchk_end(ctx, depth, len);
+
+	for (i = 0; i < n_pieces; ++i)
+		free(pieces[i].unary);
+	free(pieces);
+	return ctx->err_code;
+}
+
+const char * scan_kernel(void)
+{
+	/* same choice as errchk_par() */
+	const char * name;
+	pick_scan(&name);
+	return name;
+}
+
+static void * check_piece(void * arg)
+{
+	/* same as the loop of errchk(), from start to stop */
+	piece * pc = (piece *)arg;
+	char * curr;
+	int len, tok, par_count = pc->depth;
+
+	errchk_start(&pc->ctx);
+	for (curr = pc->start; curr < pc->stop; curr += len)
+	{
+		if ( (len = errchk_tok(&pc->ctx, pc->expr, curr, pc->end, &par_count, &tok)) == 0)
+			break;
+
+		if (UNARY_PLUS == tok || UNARY_MINUS == tok)
+		{
+			*curr = tok;
+			pc->unary[pc->n_unary++] = curr - pc->expr;
+		}
+	}
+
+	return NULL;
+}
+
+static scan_fn pick_scan(const char ** name)
+{
+	/* the widest vectors the processor has */
+#ifdef HAVE_AVX2
+	if (__builtin_cpu_supports("avx2"))
+	{
+		*name = "avx2";
+		return scan_avx2;
+	}
+#endif
+#ifdef HAVE_SSE2
+	*name = "sse2";
+	return scan_sse2;
+#else
+	*name = "scalar";
+	return scan_scalar;
+#endif
+}
+
+static void scan_scalar(const char * s, long n, long * opens, long * closes, long * signs)
+{
+	/* the reference */
+	long i;
+
+	*opens = *closes = *signs = 0;
+	for (i = 0; i < n; ++i)
+	{
+		*opens += ('(' == s[i]);
+		*closes += (')' == s[i]);
+		*signs += ('+' == s[i] || '-' == s[i]);
+	}
+
+	return;
+}
+
+#ifdef HAVE_SSE2
+static void scan_sse2(const char * s, long n, long * opens, long * closes, long * signs)
+{
+	/* a bit per matching character, counted sixteen at a time */
+	const __m128i op = _mm_set1_epi8('('), cl = _mm_set1_epi8(')');
+	const __m128i plus = _mm_set1_epi8('+'), minus = _mm_set1_epi8('-');
+	__m128i v;
+	long i, o = 0, c = 0, sg = 0;
+
+	for (i = 0; i + 16 <= n; i += 16)
+	{
+		v = _mm_loadu_si128((const __m128i *)(s + i));
+		o += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, op)));
+		c += __builtin_popcount(_mm_movemask_epi8(_mm_cmpeq_epi8(v, cl)));
+		sg += __builtin_popcount(_mm_movemask_epi8(
+			_mm_or_si128(_mm_cmpeq_epi8(v, plus), _mm_cmpeq_epi8(v, minus))));
+	}
+
+	// the rest one at a time
+	scan_scalar(s + i, n - i, opens, closes, signs);
+	*opens += o;
+	*closes += c;
+	*signs += sg;
+	return;
+}
+#endif
+
+#ifdef HAVE_AVX2
+static void scan_avx2(const char * s, long n, long * opens, long * closes, long * signs)
+{
+	/* same as above, thirty two at a time */
+	const __m256i op = _mm256_set1_epi8('('), cl = _mm256_set1_epi8(')');
+	const __m256i plus = _mm256_set1_epi8('+'), minus = _mm256_set1_epi8('-');
+	__m256i v;
+	long i, o = 0, c = 0, sg = 0;
+
+	for (i = 0; i + 32 <= n; i += 32)
+	{
+		v = _mm256_loadu_si256((const __m256i *)(s + i));
+		o += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, op)));
+		c += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, cl)));
+		sg += __builtin_popcount(_mm256_movemask_epi8(
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, plus), _mm256_cmpeq_epi8(v, minus))));
+	}
+
+	scan_scalar(s + i, n - i, opens, closes, signs);
+	*opens += o;
+	*closes += c;
+	*signs += sg;
+	return;
+}
+#endif
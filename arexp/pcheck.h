@@ -0,0 +1,34 @@
+/* pcheck.h -- interface for pcheck.c */
+
+#ifndef PCHECK_H_
+#define PCHECK_H_
+
+#include "context.h"
+
+// shorter expressions are always checked on one thread
+#define PCHECK_MIN_LEN	(1 << 20)
+
+int errchk_par(Context * ctx, char * expr, int n_threads);
+/*
+returns: same as errchk()
+
+description: Same as errchk(), with the expression cut in up to n_threads pieces
+which are checked at the same time. The error, its position, and the unary
+operators translated in expr are the same as those of errchk(), including when
+there's an error: nothing after it is translated. Expressions shorter than
+PCHECK_MIN_LEN, and those which can't be cut, are checked by errchk(). The
+threads are made for every call. Only bench.c uses it, to measure it against
+errchk(); it's not part of the library, since compile() checks every token as
+it parses it, and a check ahead of that would only be a second pass.
+
+complexity: O(n)
+*/
+
+const char * scan_kernel(void);
+/*
+returns: the name of the instruction set used to count the parentheses and
+the signs of an expression; one of "avx2", "sse2", "scalar"
+
+description: For the curious.
+*/
+#endif
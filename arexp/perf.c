@@ -0,0 +1,544 @@
+/* perf.c -- times the stages of arexp over a generated corpus */
+/* works by generating a corpus with corpus.c, timing errchk() and
+ * calculate() over it in this process, with each engine, after making sure the
+ * engines agree on every line, and on a copy of it with a character changed,
+ * to the last bit of the result and the error; then it times the arexp program
+ * over the same corpus saved in a file, once interactively and once in batch
+ * mode; last, the program is started as a server, and the corpus is sent to it
+ * a line at a time, waiting for each result, for the latency, and all at once
+ * for the throughput; every measurement is the best of a few runs, and the 
+ * results are printed on stdout as JSON, so they can be kept and compared */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "corpus.h"
+#include "errchk.h"
+#include "eval.h"
+
+// the characters put in the lines to make the engines find errors
+#define MUTANTS		"0123456789.+-*/^()x _"
+
+// default number of runs per measurement
+#define DEF_REPS	5
+
+// the default path of the program
+#define DEF_PROG	"./arexp"
+
+// the size of a shell command
+#define CMD_SIZE	1024
+
+// the size of a read from the server
+#define READ_SIZE	(64 * 1024)
+
+// how many times, 10 ms apart, to try the server before giving up
+#define CONNECT_TRIES	200
+
+// the result of one measurement; the percentiles are in seconds, and there
+// are any only when has_latency is set
+typedef struct timing_ {
+	double secs;
+	double p50;
+	double p99;
+	bool has_latency;
+	bool ok;
+} timing;
+
+// what's sent to the server by the sending thread
+typedef struct send_job_ {
+	int fd;
+	const char * text;
+	size_t len;
+} send_job;
+
+// returns the current time in seconds
+static double now(void);
+
+// the best time of errchk() over all lines
+static timing time_errchk(Context * ctx, char ** lines, int n_lines,
+	const char * text, int reps);
+
+// the best time of calculate() over all lines
+static timing time_calculate(Context * ctx, char ** lines, int n_lines, int reps);
+
+// puts back what errchk() has changed in the lines, which are in the order of the text
+static void restore_lines(char ** lines, int n_lines, const char * text);
+
+// the number of lines, and of changed copies of them, for which the engines differ
+static long engines_differ(Context * ctx, char ** lines, int n_lines, unsigned long seed);
+
+// true if the engines give the same result and error for expr
+static bool engines_agree(Context * ctx, const char * expr);
+
+// the best time of a shell command
+static timing time_command(const char * cmd, int reps);
+
+// the latency and the best time of the program running as a server
+static timing time_server(const char * prog, char ** lines, int n_lines,
+	const char * text, size_t len, int reps);
+
+// connects to the server at path; -1 on failure
+static int connect_to(const char * path);
+
+// sends the whole text and closes the sending side
+static void * send_all(void * arg);
+
+// compares doubles for qsort()
+static int cmp_double(const void * a, const void * b);
+
+// prints a measurement as a JSON object
+static void print_timing(const char * name, timing tm, int n_exprs, size_t len, bool last);
+
+// reports failed allocation and exits
+static void alloc_failed(void);
+
+/* --------------- MAIN CODE --------------- */
+int main(int argc, char * argv[])
+{
+	/* generate, measure, print */
+	static char corpus_file[] = "/tmp/arexp_corpusXXXXXX";
+	char cmd[CMD_SIZE];
+	const char * prog = DEF_PROG;
+	corpus_opts opts;
+	timing t_errchk, t_calc, t_pratt, t_cli, t_batch, t_server;
+	comp_expr cexp;
+	Context ctx;
+	char * text, * work, ** lines, * pos;
+	size_t len;
+	long invalid, differ;
+	int i, n_lines, reps = DEF_REPS, fd;
+
+	corpus_defaults(&opts);
+	for (i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-h") == 0)
+		{
+			printf("perf -- times errchk(), calculate() with each engine, and %s over random expressions\n", prog);
+			printf("\nSupported options:\n");
+			corpus_usage();
+			printf("-r<number>\t- runs per measurement, the best is kept; %d by default\n", DEF_REPS);
+			printf("-a<path>\t- the arexp program; %s by default\n", DEF_PROG);
+			return 0;
+		}
+		else if (strncmp(argv[i], "-r", 2) == 0 && (reps = atoi(argv[i] + 2)) > 0)
+			continue;
+		else if (strncmp(argv[i], "-a", 2) == 0 && argv[i][2] != '\0')
+			prog = argv[i] + 2;
+		else if (corpus_arg(&opts, argv[i]) != 1)
+		{
+			fprintf(stderr, "Err: invalid option < %s >\n", argv[i]);
+			return 1;
+		}
+	}
+
+	text = corpus_make(&opts, &len);
+
+	// the lines are cut in a copy, which errchk() changes as well
+	if ( (work = malloc(len + 1)) == NULL ||
+		(lines = malloc(opts.n_exprs * sizeof(*lines))) == NULL)
+		alloc_failed();
+	memcpy(work, text, len + 1);
+	for (n_lines = 0, pos = work; n_lines < opts.n_exprs; ++n_lines)
+	{
+		lines[n_lines] = pos;
+		pos = strchr(pos, '\n');
+		*pos++ = '\0';
+	}
+
+	context_init(&ctx);
+	ctx.verbose = false;
+
+	// every line must be valid
+	comp_init(&cexp);
+	for (i = 0, invalid = 0; i < n_lines; ++i)
+		invalid += (compile(&ctx, &cexp, lines[i]) != 0);
+	comp_destroy(&cexp);
+
+	// and must be the same with either engine
+	differ = engines_differ(&ctx, lines, n_lines, opts.seed);
+
+	t_errchk = time_errchk(&ctx, lines, n_lines, text, reps);
+	restore_lines(lines, n_lines, text);
+	ctx.engine = ENGINE_QUEUES;
+	t_calc = time_calculate(&ctx, lines, n_lines, reps);
+	ctx.engine = ENGINE_PRATT;
+	t_pratt = time_calculate(&ctx, lines, n_lines, reps);
+	ctx.engine = ENGINE_QUEUES;
+
+	// the program reads the corpus from a file
+	t_cli.ok = t_batch.ok = false;
+	if ( (fd = mkstemp(corpus_file)) != -1)
+	{
+		if (write(fd, text, len) == (ssize_t)len)
+		{
+			snprintf(cmd, CMD_SIZE, "'%s' < '%s' > /dev/null 2>&1", prog, corpus_file);
+			t_cli = time_command(cmd, reps);
+			snprintf(cmd, CMD_SIZE, "'%s' -b '%s' > /dev/null 2>&1", prog, corpus_file);
+			t_batch = time_command(cmd, reps);
+		}
+		close(fd);
+		unlink(corpus_file);
+	}
+
+	t_server = time_server(prog, lines, n_lines, text, len, reps);
+
+	printf("{\n");
+	printf("  \"corpus\": {\"expressions\": %d, \"bytes\": %lu, \"operands\": %d, "
+	"\"depth\": %d, \"mix\": \"%s\", \"seed\": %lu, \"invalid\": %ld},\n",
+	opts.n_exprs, (unsigned long)len, opts.n_operands, opts.max_depth, opts.mix,
+	opts.seed, invalid);
+	printf("  \"runs\": %d,\n", reps);
+	printf("  \"engines_differ\": %ld,\n", differ);
+#ifdef __VERSION__
+	printf("  \"compiler\": \"%s\",\n", __VERSION__);
+#endif
+	print_timing("errchk", t_errchk, n_lines, len, false);
+	print_timing("calculate", t_calc, n_lines, len, false);
+	print_timing("pratt", t_pratt, n_lines, len, false);
+	print_timing("cli", t_cli, n_lines, len, false);
+	print_timing("batch", t_batch, n_lines, len, false);
+	print_timing("server", t_server, n_lines, len, true);
+	printf("}\n");
+
+	context_destroy(&ctx);
+	free(lines);
+	free(work);
+	free(text);
+	return (differ != 0);
+}
+
+static timing time_errchk(Context * ctx, char ** lines, int n_lines,
+	const char * text, int reps)
+{
+	/* errchk() replaces the unary operators, so every run gets a fresh copy;
+	 * the lines are in the order of the text */
+	timing tm = {0.0, 0.0, 0.0, false, true};
+	double start, t;
+	int i, j;
+
+	for (j = 0; j < reps; ++j)
+	{
+		restore_lines(lines, n_lines, text);
+
+		start = now();
+		for (i = 0; i < n_lines; ++i)
+			errchk(ctx, lines[i]);
+		t = now() - start;
+
+		if (0 == j || t < tm.secs)
+			tm.secs = t;
+	}
+
+	return tm;
+}
+
+static timing time_calculate(Context * ctx, char ** lines, int n_lines, int reps)
+{
+	/* calculate() doesn't change the string */
+	timing tm = {0.0, 0.0, 0.0, false, true};
+	volatile double sink;
+	double start, t;
+	int i, j;
+
+	for (j = 0; j < reps; ++j)
+	{
+		start = now();
+		for (i = 0; i < n_lines; ++i)
+			sink = calculate(ctx, lines[i]);
+		t = now() - start;
+
+		if (0 == j || t < tm.secs)
+			tm.secs = t;
+	}
+
+	(void)sink;
+	return tm;
+}
+
+static void restore_lines(char ** lines, int n_lines, const char * text)
+{
+	/* the first line is where the copy of the text begins */
+	char * work = lines[0];
+	int i;
+
+	for (i = 0; i < n_lines; ++i)
+		memcpy(lines[i], text + (lines[i] - work), strlen(lines[i]));
+
+	return;
+}
+
+static long engines_differ(Context * ctx, char ** lines, int n_lines, unsigned long seed)
+{
+	/* a changed copy is mostly an error, found at the change or after it */
+	char * copy = NULL;
+	size_t len, size = 0;
+	long differ = 0;
+	int i;
+
+	srand(seed);
+	for (i = 0; i < n_lines; ++i)
+	{
+		differ += !engines_agree(ctx, lines[i]);
+
+		len = strlen(lines[i]);
+		if (len + 1 > size)
+		{
+			size = len + 1;
+			if ( (copy = realloc(copy, size)) == NULL)
+				alloc_failed();
+		}
+		memcpy(copy, lines[i], len + 1);
+		if (len > 0)
+			copy[rand() % len] = MUTANTS[rand() % (sizeof(MUTANTS) - 1)];
+		differ += !engines_agree(ctx, copy);
+	}
+
+	ctx->engine = ENGINE_QUEUES;
+	free(copy);
+	return differ;
+}
+
+static bool engines_agree(Context * ctx, const char * expr)
+{
+	/* the bits, so -0 is not 0; which NAN an operation with two of them gives
+	 * depends on the order the compiler puts the operands in, so any will do */
+	double res_queues, res_pratt;
+	int code, pos, ch, next;
+	const char * list;
+
+	ctx->engine = ENGINE_QUEUES;
+	res_queues = calculate(ctx, expr);
+	code = ctx->err_code;
+	pos = ctx->err_pos;
+	ch = ctx->err_char;
+	next = ctx->err_next;
+	list = ctx->err_list;
+
+	ctx->engine = ENGINE_PRATT;
+	res_pratt = calculate(ctx, expr);
+
+	if ((memcmp(&res_queues, &res_pratt, sizeof(double)) == 0 ||
+		(isnan(res_queues) && isnan(res_pratt))) &&
+		code == ctx->err_code && pos == ctx->err_pos && ch == ctx->err_char &&
+		next == ctx->err_next && list == ctx->err_list)
+		return true;
+
+	fprintf(stderr, "Err: the engines differ on < %s >\n", expr);
+	return false;
+}
+
+static timing time_command(const char * cmd, int reps)
+{
+	/* a failed run fails the measurement */
+	timing tm = {0.0, 0.0, 0.0, false, true};
+	double start, t;
+	int j;
+
+	for (j = 0; j < reps; ++j)
+	{
+		start = now();
+		if (system(cmd) != 0)
+		{
+			fprintf(stderr, "Err: < %s > failed\n", cmd);
+			tm.ok = false;
+			break;
+		}
+		t = now() - start;
+
+		if (0 == j || t < tm.secs)
+			tm.secs = t;
+	}
+
+	return tm;
+}
+
+static timing time_server(const char * prog, char ** lines, int n_lines,
+	const char * text, size_t len, int reps)
+{
+	/* start the server, wait until it takes connections, measure, and stop it */
+	static char sock_dir[] = "/tmp/arexp_sockXXXXXX";
+	char path[CMD_SIZE], * buff;
+	timing tm = {0.0, 0.0, 0.0, false, false};
+	double * lat, start, t;
+	pthread_t sender;
+	send_job job;
+	size_t got, n_nl;
+	ssize_t n;
+	pid_t pid;
+	int i, j, fd = -1;
+
+	if (mkdtemp(sock_dir) == NULL)
+		return tm;
+	snprintf(path, CMD_SIZE, "%s/arexp.sock", sock_dir);
+
+	if ( (lat = malloc(n_lines * sizeof(*lat))) == NULL ||
+		(buff = malloc(READ_SIZE)) == NULL)
+		alloc_failed();
+
+	if ( (pid = fork()) == 0)
+	{
+		freopen("/dev/null", "w", stderr);
+		execl(prog, prog, "-d", path, (char *)NULL);
+		_exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; pid > 0 && i < CONNECT_TRIES && (fd = connect_to(path)) == -1; ++i)
+		usleep(10000);
+	if (-1 == fd)
+	{
+		fprintf(stderr, "Err: can't reach < %s > on < %s >\n", prog, path);
+		goto out;
+	}
+
+	// one line at a time, from the text, since errchk() has changed the lines;
+	// a result is a single line
+	for (i = 0; i < n_lines; ++i)
+	{
+		n = strlen(lines[i]) + 1;
+		start = now();
+		if (write(fd, text + (lines[i] - lines[0]), n) != n)
+			break;
+		do
+		{
+			if ( (n = read(fd, buff, READ_SIZE)) <= 0)
+				break;
+		} while (buff[n - 1] != '\n');
+		if (n <= 0)
+			break;
+		lat[i] = now() - start;
+	}
+	close(fd);
+	if (i < n_lines)
+		goto out;
+
+	qsort(lat, n_lines, sizeof(*lat), cmp_double);
+	tm.p50 = lat[n_lines / 2];
+	tm.p99 = lat[(long)n_lines * 99 / 100];
+	tm.has_latency = true;
+
+	// all at once; there are as many results as lines
+	for (j = 0; j < reps; ++j)
+	{
+		if ( (fd = connect_to(path)) == -1)
+			goto out;
+
+		start = now();
+		job.fd = fd;
+		job.text = text;
+		job.len = len;
+		pthread_create(&sender, NULL, send_all, &job);
+
+		n_nl = 0;
+		while ( (n = read(fd, buff, READ_SIZE)) > 0)
+		{
+			for (got = 0; got < (size_t)n; ++got)
+				n_nl += ('\n' == buff[got]);
+		}
+		t = now() - start;
+
+		pthread_join(sender, NULL);
+		close(fd);
+		if (n_nl != (size_t)n_lines)
+			goto out;
+
+		if (0 == j || t < tm.secs)
+			tm.secs = t;
+	}
+	tm.ok = true;
+
+out:
+	if (pid > 0)
+	{
+		kill(pid, SIGTERM);
+		waitpid(pid, NULL, 0);
+	}
+	unlink(path);
+	rmdir(sock_dir);
+	free(buff);
+	free(lat);
+	return tm;
+}
+
+static int connect_to(const char * path)
+{
+	/* a blocking socket */
+	struct sockaddr_un addr;
+	int fd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+	if ( (fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1)
+		return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+	{
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+static void * send_all(void * arg)
+{
+	/* the reading side is busy with the results meanwhile */
+	send_job * job = (send_job *)arg;
+	size_t sent = 0;
+	ssize_t n;
+
+	while (sent < job->len && (n = write(job->fd, job->text + sent, job->len - sent)) > 0)
+		sent += n;
+	shutdown(job->fd, SHUT_WR);
+	return NULL;
+}
+
+static int cmp_double(const void * a, const void * b)
+{
+	/* ascending */
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+static void print_timing(const char * name, timing tm, int n_exprs, size_t len, bool last)
+{
+	/* null when it failed */
+	if (!tm.ok || tm.secs <= 0)
+	{
+		printf("  \"%s\": null%s\n", name, last ? "" : ",");
+		return;
+	}
+
+	printf("  \"%s\": {\"seconds\": %.6f, \"ns_per_expr\": %.1f, \"exprs_per_s\": %.0f, "
+	"\"mb_per_s\": %.2f", name, tm.secs, tm.secs / n_exprs * 1e9, n_exprs / tm.secs,
+	len / tm.secs / 1e6);
+	if (tm.has_latency)
+		printf(", \"p50_us\": %.1f, \"p99_us\": %.1f", tm.p50 * 1e6, tm.p99 * 1e6);
+	printf("}%s\n", last ? "" : ",");
+	return;
+}
+
+static double now(void)
+{
+	/* monotonic time in seconds */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void alloc_failed(void)
+{
+	/* nothing sensible can be done */
+	fprintf(stderr, "Err: memory allocation failed\n");
+	exit(EXIT_FAILURE);
+}
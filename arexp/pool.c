@@ -0,0 +1,110 @@
+/* pool.c -- an implementation of a fixed size block pool */
+
+#include <stdlib.h> // for NULL
+#include <string.h> // for memset()
+#include "pool.h"
+
+// every block is aligned on this boundary
+#define POOL_ALIGN	16
+
+// rounds n up to the alignment
+#define ALIGN_UP(n)	(((n) + POOL_ALIGN - 1) & ~((size_t)POOL_ALIGN - 1))
+
+// the address of the first block of a chunk
+#define FIRST_BLOCK(chunk) ((char *)(chunk) + ALIGN_UP(sizeof(PoolChunk)))
+
+void pool_init(Pool * pool, size_t block_size, int chunk_blocks)
+{
+	/* initialize the pool */
+	if (block_size < sizeof(PoolBlock))
+		block_size = sizeof(PoolBlock);
+	
+	pool->block_size = ALIGN_UP(block_size);
+	pool->chunk_blocks = chunk_blocks;
+	pool->used = 0;
+	pool->head = NULL;
+	pool->curr = NULL;
+	pool->free_list = NULL;
+	pool->heap_calls = 0;
+	
+	return;
+}
+
+void pool_destroy(Pool * pool)
+{
+	/* free each chunk */
+	PoolChunk * chunk, * next;
+	
+	for (chunk = pool->head; chunk != NULL; chunk = next)
+	{
+		next = chunk->next;
+		free(chunk);
+	}
+	// zero out memory of the structure
+	memset(pool, 0, sizeof(*pool));
+	
+	return;
+}
+
+void * pool_alloc(Pool * pool)
+{
+	/* get a block */
+	PoolBlock * block;
+	PoolChunk * chunk;
+	
+	// reuse a freed block
+	if (pool->free_list != NULL)
+	{
+		block = pool->free_list;
+		pool->free_list = block->next;
+		return block;
+	}
+	
+	// move to the next chunk when the current one is used up
+	if (NULL == pool->curr || pool->used == pool->chunk_blocks)
+	{
+		chunk = (NULL == pool->curr) ? pool->head : pool->curr->next;
+		
+		// allocate storage if there's no chunk left from before a reset
+		if (NULL == chunk)
+		{
+			chunk = malloc(ALIGN_UP(sizeof(*chunk)) + pool->block_size * pool->chunk_blocks);
+			if (NULL == chunk)
+				return NULL;
+			
+			pool->heap_calls++;
+			chunk->next = NULL;
+			if (NULL == pool->curr)
+				pool->head = chunk;
+			else
+				pool->curr->next = chunk;
+		}
+		
+		pool->curr = chunk;
+		pool->used = 0;
+	}
+	
+	// carve from the current chunk
+	return FIRST_BLOCK(pool->curr) + pool->block_size * pool->used++;
+}
+
+void pool_free(Pool * pool, void * data)
+{
+	/* put the block on the free list */
+	PoolBlock * block = (PoolBlock *)data;
+	
+	block->next = pool->free_list;
+	pool->free_list = block;
+	
+	return;
+}
+
+void pool_reset(Pool * pool)
+{
+	/* start carving from the first chunk again */
+	pool->curr = NULL;
+	pool->used = 0;
+	pool->free_list = NULL;
+	
+	return;
+}
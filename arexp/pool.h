@@ -0,0 +1,78 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stdlib.h>
+
+/* structure for a free block */
+typedef struct PoolBlock_ {
+	struct PoolBlock_ * next;
+} PoolBlock;
+
+/* structure for a chunk of blocks allocated at once */
+typedef struct PoolChunk_ {
+	struct PoolChunk_ * next;
+} PoolChunk;
+
+/* structure for the pool */
+typedef struct Pool_ {
+	size_t block_size;
+	int chunk_blocks;
+	int used;
+	PoolChunk * head;
+	PoolChunk * curr;
+	PoolBlock * free_list;
+	long heap_calls;
+} Pool;
+
+/* public interface */
+void pool_init(Pool * pool, size_t block_size, int chunk_blocks);
+/* 
+returns: nothing
+
+description: Initializes the pool specified by pool. Must be called before pool can be used. 
+Every block handed out by the pool is block_size bytes long. Memory is taken from the heap 
+chunk_blocks blocks at a time. heap_calls counts how many times that has happened.
+
+complexity: O(1) 
+*/
+
+void pool_destroy(Pool * pool);
+/*
+returns: nothing
+
+description: Returns all memory of the pool to the heap. No other operations are permitted after 
+calling pool_destroy.
+
+complexity: O(n), where n is the number of chunks
+*/
+
+void * pool_alloc(Pool * pool);
+/*
+returns: pointer to a block on success, NULL on failure
+
+description: Takes a block from the free list, or carves a new one from the current chunk. 
+Allocates a new chunk only when all chunks are used up.
+
+complexity: O(1)
+*/
+
+void pool_free(Pool * pool, void * data);
+/*
+returns: nothing
+
+description: Puts the block pointed to by data on the free list.
+
+complexity: O(1)
+*/
+
+void pool_reset(Pool * pool);
+/*
+returns: nothing
+
+description: Marks every block of the pool as free without returning anything to the heap. 
+All blocks handed out before the call become invalid.
+
+complexity: O(1)
+*/
+
+#endif
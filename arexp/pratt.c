@@ -0,0 +1,163 @@
+/* pratt.c -- evaluates infix arithmetic expressions in one pass */
+/* works by precedence climbing without recursion: the operands go on a stack
+ * of values, the operators on a stack of their own; before an operator is
+ * pushed, the ones on the stack which bind at least as tightly are performed
+ * on the values on top, except for ^, which waits for those of its own kind
+ * since it's right associative; a ( stops this until its ) performs everything
+ * after it; unary minus binds tighter than anything, as in eval.c, so the
+ * operations and their operands are the same, and so are the results */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "errchk.h"
+#include "numconv.h"
+#include "pratt.h"
+
+// how tightly an operator binds; ( binds nothing
+static const unsigned char op_prec[128] = {
+	['('] = 0, ['+'] = 1, ['-'] = 1, ['*'] = 2, ['/'] = 2, ['^'] = 3, [UNARY_MINUS] = 4,
+};
+
+#define PREC(op)	(op_prec[(unsigned char)(op)])
+
+// performs op on the values on top of vals, of which there are *n_vals
+static void perform(double * vals, int * n_vals, int op);
+
+// makes sure the operator stack of ctx has room for n operators
+static int ops_reserve(Context * ctx, int n);
+
+/* --------------- MAIN CODE --------------- */
+int pratt_calc(Context * ctx, const char * expr, int len, double * result)
+{
+	/* check every token as it's read, the same way parse() in eval.c does */
+	const char * curr = expr, * end = expr + len;
+	double * vals;
+	char * ops;
+	int n_vals = 0, n_ops = 0, depth = 0, par_count = 0;
+	int tok, tok_len, num_len, prec;
+	bool numbers = false;
+
+	errchk_start(ctx);
+	*result = NAN;
+
+	// there are no more operands than in compile(), and no more operators
+	// than characters
+	if (context_reserve(ctx, len / 2 + 1) != 0 || ops_reserve(ctx, len + 1) != 0)
+		return err_set(ctx, ERR_MEMORY, 0);
+	vals = ctx->work;
+	ops = ctx->pratt_ops;
+
+	while (curr < end)
+	{
+		if ( (tok_len = errchk_tok(ctx, expr, curr, end, &par_count, &tok)) == 0)
+			return ctx->err_code;
+
+		switch (tok)
+		{
+			case NUMBER:
+				// the checker has already eaten it
+				vals[n_vals++] = numconv(curr, curr + tok_len, &num_len);
+				numbers = true;
+				break;
+			case NAME:
+				return PRATT_NAMES;
+				break;
+			case UNARY_PLUS:
+				// do nothing
+				break;
+			case UNARY_MINUS:
+				// nothing is tighter, so nothing is performed
+				ops[n_ops++] = UNARY_MINUS;
+				break;
+			case '(':
+				if (ctx->max_depth > 0 && depth == ctx->max_depth)
+					return err_set(ctx, ERR_DEPTH, curr - expr);
+				++depth;
+				ops[n_ops++] = '(';
+				break;
+			case ')':
+				// everything since the (, which the checker has made sure is there
+				while (ops[n_ops - 1] != '(')
+					perform(vals, &n_vals, ops[--n_ops]);
+				--n_ops;
+				--depth;
+				break;
+			default:
+				// a binary operator; one more for ^ lets those before it wait
+				prec = PREC(tok) + ('^' == tok);
+				while (n_ops > 0 && PREC(ops[n_ops - 1]) >= prec)
+					perform(vals, &n_vals, ops[--n_ops]);
+				ops[n_ops++] = tok;
+				break;
+		}
+
+		curr += tok_len;
+	}
+
+	// the same order of errors as compile()
+	if (!numbers)
+		return err_set(ctx, ERR_NO_NUMBERS, len);
+	if (errchk_end(ctx, par_count, len) != ERR_NONE)
+		return ctx->err_code;
+
+	while (n_ops > 0)
+		perform(vals, &n_vals, ops[--n_ops]);
+
+	*result = vals[0];
+	return ERR_NONE;
+}
+
+static void perform(double * vals, int * n_vals, int op)
+{
+	/* the result takes the place of the left operand */
+	double * lhs, rhs;
+
+	if (UNARY_MINUS == op)
+	{
+		// negate number
+		vals[*n_vals - 1] = -vals[*n_vals - 1];
+		return;
+	}
+
+	rhs = vals[--*n_vals];
+	lhs = &vals[*n_vals - 1];
+	switch (op)
+	{
+		case '^':
+			*lhs = pow(*lhs, rhs);
+			break;
+		case '*':
+			*lhs = *lhs * rhs;
+			break;
+		case '/':
+			*lhs = *lhs / rhs;
+			break;
+		case '+':
+			*lhs = *lhs + rhs;
+			break;
+		default:
+			*lhs = *lhs - rhs;
+			break;
+	}
+
+	return;
+}
+
+static int ops_reserve(Context * ctx, int n)
+{
+	/* grow to at least double the size */
+	char * new_ops;
+	int new_size;
+
+	if (n <= ctx->pratt_size)
+		return 0;
+
+	new_size = (ctx->pratt_size * 2 > n) ? ctx->pratt_size * 2 : n;
+	if ( (new_ops = realloc(ctx->pratt_ops, new_size)) == NULL)
+		return -1;
+	ctx->pratt_ops = new_ops;
+	ctx->pratt_size = new_size;
+	return 0;
+}
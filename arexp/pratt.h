@@ -0,0 +1,26 @@
+/* pratt.h -- interface for pratt.c */
+
+#ifndef PRATT_H_
+#define PRATT_H_
+
+#include "context.h"
+
+// returned by pratt_calc() for an expression with names
+#define PRATT_NAMES	(-1)
+
+int pratt_calc(Context * ctx, const char * expr, int len, double * result);
+/*
+returns: ERR_NONE on success, one of the error codes in context.h otherwise,
+with the error in ctx; PRATT_NAMES if expr has a name
+
+description: Checks and evaluates the len characters at expr in a single pass
+from left to right, by precedence climbing with a stack of values and a stack
+of operators, without compiling anything. The result is in *result. The result
+and the errors are the same as those of compile() followed by evaluate(), to
+the bit. Names can't be given values here, so an expression with one is left
+to compile(). The stacks are kept in ctx, and the nesting of parentheses is
+limited by ctx->max_depth, the same as in compile().
+
+complexity: O(n)
+*/
+#endif
@@ -6,8 +6,17 @@
 #include "queue.h"
 
 void queue_init(Queue * queue, void (*destroy)(void * data))
+{
+	/* initialize the queue with elements from the heap */
+	queue_init_pool(queue, destroy, NULL);
+	
+	return;
+}
+
+void queue_init_pool(Queue * queue, void (*destroy)(void * data), Pool * pool)
 {
 	/* initialize the queue */
+	queue->pool = pool;
 	queue->size = 0;
 	queue->destroy = destroy;
 	queue->head = NULL;
@@ -38,7 +47,12 @@ int queue_enq(Queue * queue, const void * data)
 	QueueElmt * new_element;
 	
 	// allocate storage
-	if ( (new_element = (QueueElmt *)malloc(sizeof(*new_element))) == NULL )
+	if (queue->pool != NULL)
+		new_element = (QueueElmt *)pool_alloc(queue->pool);
+	else
+		new_element = (QueueElmt *)malloc(sizeof(*new_element));
+	
+	if (NULL == new_element)
 		return -1;
 	
 	new_element->data = (void *)data;
@@ -81,7 +95,10 @@ int queue_deq(Queue * queue, void ** data)
 	queue->head = queue->head->next;
 	
 	// free element memory
-	free(old_element);
+	if (queue->pool != NULL)
+		pool_free(queue->pool, old_element);
+	else
+		free(old_element);
 	
 	// adjust size
 	queue->size--;
@@ -2,6 +2,7 @@
 #define QUEUE_H_
 
 #include <stdlib.h>
+#include "pool.h"
 
 /* structure for the elements */
 typedef struct QueueElmt_ {
@@ -13,6 +14,7 @@ typedef struct QueueElmt_ {
 typedef struct Queue_ {
 	int size;
 	void (*destroy)(void * data);
+	Pool * pool;
 	QueueElmt * head;
 	QueueElmt * tail;
 } Queue;
@@ -29,6 +31,16 @@ if elements must not be deallocated after the queue is destroyed.
 complexity: O(1) 
 */
 
+void queue_init_pool(Queue * queue, void (*destroy)(void * data), Pool * pool);
+/* 
+returns: nothing
+
+description: Same as queue_init, but the elements of queue are taken from pool instead of the heap. 
+pool must be initialized with a block size of at least sizeof(QueueElmt).
+
+complexity: O(1) 
+*/
+
 void queue_destroy(Queue * queue);
 /*
 returns: nothing
@@ -0,0 +1,110 @@
+/* rqueue.c -- an implementation of a queue in a ring buffer */
+
+#include <stdlib.h> // for NULL
+#include <string.h> // for memset(), memcpy()
+#include "rqueue.h"
+
+// the first size of the buffer
+#define RQUEUE_MIN_CAP	16
+
+// makes room for one more element
+static int grow(RQueue * queue);
+
+void rqueue_init(RQueue * queue, void (*destroy)(void * data))
+{
+	/* initialize the queue */
+	queue->size = 0;
+	queue->destroy = destroy;
+	queue->buff = NULL;
+	queue->cap = 0;
+	queue->head = 0;
+	
+	return;
+}
+
+void rqueue_destroy(RQueue * queue)
+{
+	/* remove each element */
+	void * data;
+	
+	while (queue->size > 0)
+	{
+		if ( (rqueue_deq(queue, (void **)&data) == 0) && (queue->destroy != NULL) )
+			queue->destroy(data);
+	}
+	free(queue->buff);
+	// zero out memory of the structure
+	memset(queue, 0, sizeof(*queue));
+	
+	return;
+}
+
+void rqueue_clear(RQueue * queue)
+{
+	/* forget the elements, keep the buffer */
+	queue->size = 0;
+	queue->head = 0;
+	
+	return;
+}
+
+int rqueue_enq(RQueue * queue, const void * data)
+{
+	/* enqueue element */
+	if (queue->size == queue->cap && grow(queue) != 0)
+		return -1;
+	
+	// insert at the back of the queue
+	queue->buff[(queue->head + queue->size) & (queue->cap - 1)] = (void *)data;
+	
+	// adjust the size
+	queue->size++;
+	
+	return 0;
+}
+
+int rqueue_deq(RQueue * queue, void ** data)
+{
+	/* dequeue element */
+	
+	// don't remove from an empty queue
+	if (0 == queue->size)
+		return -1;
+	
+	// remove the head
+	*data = queue->buff[queue->head];
+	queue->head = (queue->head + 1) & (queue->cap - 1);
+	
+	// adjust size
+	queue->size--;
+	
+	return 0;
+}
+
+static int grow(RQueue * queue)
+{
+	/* double the buffer; the elements are unwrapped to its start */
+	void ** new_buff;
+	int new_cap, first;
+	
+	new_cap = (queue->cap > 0) ? queue->cap * 2 : RQUEUE_MIN_CAP;
+	if ( (new_buff = malloc(new_cap * sizeof(*new_buff))) == NULL)
+		return -1;
+	
+	// the elements from head to the end of the buffer, then those which wrapped
+	first = queue->cap - queue->head;
+	if (first > queue->size)
+		first = queue->size;
+	if (queue->size > 0)
+	{
+		memcpy(new_buff, queue->buff + queue->head, first * sizeof(*new_buff));
+		memcpy(new_buff + first, queue->buff, (queue->size - first) * sizeof(*new_buff));
+	}
+	
+	free(queue->buff);
+	queue->buff = new_buff;
+	queue->cap = new_cap;
+	queue->head = 0;
+	
+	return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef RQUEUE_H_
+#define RQUEUE_H_
+
+#include <stdlib.h>
+
+/* structure for the ring queue
+ * the elements are kept in buff, which has room for cap of them; cap is 0 or a 
+ * power of two, so the positions wrap with a mask; head is the position of the 
+ * first element */
+typedef struct RQueue_ {
+	int size;
+	void (*destroy)(void * data);
+	void ** buff;
+	int cap;
+	int head;
+} RQueue;
+
+/* public interface */
+void rqueue_init(RQueue * queue, void (*destroy)(void * data));
+/* 
+returns: nothing
+
+description: Initializes the queue specified by queue. Must be called before queue can be used. 
+destroy provides a user defined way of freeing memory when rqueue_destroy is called. destroy can be NULL
+if elements must not be deallocated after the queue is destroyed. No memory is allocated until the 
+first element is enqueued.
+
+complexity: O(1) 
+*/
+
+void rqueue_destroy(RQueue * queue);
+/*
+returns: nothing
+
+description: Destroys queue by calling destroy provided in rqueue_init, if it's not NULL, and frees 
+its buffer. No other operations are permitted after calling rqueue_destroy.
+
+complexity: O(n)
+*/
+
+void rqueue_clear(RQueue * queue);
+/*
+returns: nothing
+
+description: Removes every element of queue without calling destroy. The buffer is kept, so a queue 
+which is cleared and filled again allocates nothing once it's big enough.
+
+complexity: O(1)
+*/
+
+int rqueue_enq(RQueue * queue, const void * data);
+/*
+returns: 0 on success, -1 on failure
+
+description: Pushes an element on the queue. The buffer doubles when it's full.
+
+complexity: O(1) amortized
+*/
+
+int rqueue_deq(RQueue * queue, void ** data);
+/*
+returns: 0 on success, -1 on failure
+
+description: Dequeues an element from the queue. Upon return, data points to the data stored in the 
+element that was popped. The caller manages memory.
+
+complexity: O(1)
+*/
+
+#define rqueue_peek(queue) ((queue)->size == 0 ? NULL : (queue)->buff[(queue)->head])
+/*
+returns: pointer to the data at the front of the queue, or NULL if queue is empty.
+
+description: Macro for peeking in the queue.
+
+complexity: O(1)
+*/
+
+#endif
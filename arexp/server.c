@@ -0,0 +1,550 @@
+/* server.c -- evaluates expressions sent over a local socket */
+/* works by reading from all connections in a single thread with epoll;
+ * the whole lines a connection has sent so far go to the workers as one job,
+ * and a connection has at most one job at a time, so its results come back
+ * in order while the lines sent meanwhile wait for the next job; a worker
+ * evaluates the lines with batch_lines(), puts the connection on the done
+ * list, and wakes the main thread with an eventfd, which then writes the
+ * results out without blocking */
+
+// for accept4()
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "server.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include "context.h"
+#include "eval.h"
+#include "stats.h"
+#include "batch.h"
+
+// the most events handled in one epoll_wait()
+#define MAX_EVENTS	64
+
+// the size of a read from a connection
+#define READ_SIZE	(64 * 1024)
+
+// results waiting to be sent past this stop a connection from being read
+#define OUT_HIGH	(1024 * 1024)
+
+// lines waiting for a busy connection past this stop it from being read
+#define IN_HIGH		(1024 * 1024)
+
+// a connection
+// in - what's been read; the whole lines go to the job, the rest waits
+// job - the lines the workers are on
+// res - the results of the job
+// out - the results waiting to be sent, from sent on
+// busy - the workers have the job; nothing but out is touched by the main 
+//        thread until it's done
+// eof - the client won't send any more
+// events - what epoll is watching for; 0 when it's not in epoll at all, since
+//          a hung up socket is reported whatever it's watched for
+typedef struct conn_ {
+	int fd;
+	batch_buff in;
+	batch_buff job;
+	batch_buff res;
+	batch_buff out;
+	size_t sent;
+	bool busy;
+	bool eof;
+	unsigned events;
+	struct conn_ * next;
+} conn;
+
+// shared by all threads
+typedef struct server_ {
+	int f_prec;
+	bool stats;
+	bool quit;
+	int wake_fd;
+	conn * jobs;
+	conn ** jobs_tail;
+	conn * done;
+	ctx_stats total;
+	pthread_mutex_t lock;
+	pthread_cond_t has_job;
+} server;
+
+// the listening socket at path; -1 on error
+static int listen_at(const char * path);
+
+// the worker thread
+static void * worker(void * arg);
+
+// takes a new connection
+static void conn_accept(int epfd, int lfd);
+
+// reads what's there; false at the end or on error
+static bool conn_read(conn * cn);
+
+// writes what it can; false on error
+static bool conn_write(conn * cn);
+
+// forgets everything but the job, so the connection is closed as soon as it can be
+static void conn_drop(conn * cn);
+
+// hands the whole lines read so far to the workers, if it can
+static void conn_dispatch(server * srv, conn * cn);
+
+// tells epoll what the connection waits for now; closes it when it's finished
+static void conn_update(int epfd, conn * cn);
+
+// closes the connection and frees it
+static void conn_close(conn * cn);
+
+// makes sure buff has room for size more bytes; -1 on failure
+static int buff_reserve(batch_buff * buff, size_t size);
+
+/* --------------- MAIN CODE --------------- */
+int server_run(const char * path, int f_prec, bool stats)
+{
+	/* set up, then wait for events until a signal says stop */
+	struct epoll_event ev, events[MAX_EVENTS];
+	struct signalfd_siginfo sig;
+	pthread_t * threads;
+	sigset_t mask;
+	server srv;
+	conn * cn, * next;
+	uint64_t wakes;
+	bool quit = false, woke;
+	int i, n, epfd, lfd, sfd, n_threads;
+	
+	// the workers inherit the mask, so the signals come to the main thread
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &mask, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	
+	if ( (lfd = listen_at(path)) == -1)
+		return -1;
+	
+	sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	srv.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (-1 == sfd || -1 == srv.wake_fd || -1 == epfd)
+	{
+		perror("Err: server");
+		unlink(path);
+		return -1;
+	}
+	
+	// the three of them are told apart by data.ptr
+	ev.events = EPOLLIN;
+	ev.data.ptr = &lfd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev);
+	ev.data.ptr = &sfd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, sfd, &ev);
+	ev.data.ptr = &srv.wake_fd;
+	epoll_ctl(epfd, EPOLL_CTL_ADD, srv.wake_fd, &ev);
+	
+	srv.f_prec = f_prec;
+	srv.stats = stats;
+	srv.quit = false;
+	srv.jobs = srv.done = NULL;
+	srv.jobs_tail = &srv.jobs;
+	memset(&srv.total, 0, sizeof(srv.total));
+	pthread_mutex_init(&srv.lock, NULL);
+	pthread_cond_init(&srv.has_job, NULL);
+	
+	n_threads = batch_threads();
+	if ( (threads = malloc(n_threads * sizeof(*threads))) == NULL)
+	{
+		fprintf(stderr, "Err: memory allocation failed\n");
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < n_threads; ++i)
+		pthread_create(&threads[i], NULL, worker, &srv);
+	
+	fprintf(stderr, "listening on %s with %d threads\n", path, n_threads);
+	
+	while (!quit)
+	{
+		if ( (n = epoll_wait(epfd, events, MAX_EVENTS, -1)) == -1)
+		{
+			if (EINTR == errno)
+				continue;
+			perror("Err: epoll_wait");
+			break;
+		}
+		
+		// the finished jobs are seen to after the events, since a connection
+		// closed on the way mustn't be among the events that follow
+		woke = false;
+		for (i = 0; i < n; ++i)
+		{
+			if (&lfd == events[i].data.ptr)
+				conn_accept(epfd, lfd);
+			else if (&sfd == events[i].data.ptr)
+			{
+				if (read(sfd, &sig, sizeof(sig)) == sizeof(sig))
+					quit = true;
+			}
+			else if (&srv.wake_fd == events[i].data.ptr)
+				woke = (read(srv.wake_fd, &wakes, sizeof(wakes)) == sizeof(wakes));
+			else
+			{
+				cn = (conn *)events[i].data.ptr;
+				if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !conn_read(cn))
+					cn->eof = true;
+				if ((events[i].events & (EPOLLOUT | EPOLLERR)) && !conn_write(cn))
+					conn_drop(cn);
+				conn_dispatch(&srv, cn);
+				conn_update(epfd, cn);
+			}
+		}
+		
+		if (!woke)
+			continue;
+		
+		// the results of the finished jobs go out
+		pthread_mutex_lock(&srv.lock);
+		cn = srv.done;
+		srv.done = NULL;
+		pthread_mutex_unlock(&srv.lock);
+		
+		for (; cn != NULL; cn = next)
+		{
+			next = cn->next;
+			cn->busy = false;
+			if (buff_reserve(&cn->out, cn->res.len) != 0)
+				conn_drop(cn);
+			else
+			{
+				memcpy(cn->out.text + cn->out.len, cn->res.text, cn->res.len);
+				cn->out.len += cn->res.len;
+			}
+			cn->res.len = 0;
+			
+			if (!conn_write(cn))
+				conn_drop(cn);
+			conn_dispatch(&srv, cn);
+			conn_update(epfd, cn);
+		}
+	}
+	
+	// let the workers finish what they're on and go
+	pthread_mutex_lock(&srv.lock);
+	srv.quit = true;
+	pthread_cond_broadcast(&srv.has_job);
+	pthread_mutex_unlock(&srv.lock);
+	for (i = 0; i < n_threads; ++i)
+		pthread_join(threads[i], NULL);
+	
+	if (srv.stats)
+		stats_print(stderr, &srv.total);
+	
+	// whatever is still open goes with the process
+	close(epfd);
+	close(lfd);
+	close(sfd);
+	close(srv.wake_fd);
+	unlink(path);
+	pthread_cond_destroy(&srv.has_job);
+	pthread_mutex_destroy(&srv.lock);
+	free(threads);
+	
+	return 0;
+}
+
+static int listen_at(const char * path)
+{
+	/* a stale socket from an earlier run is removed */
+	struct sockaddr_un addr;
+	int fd;
+	
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		fprintf(stderr, "Err: socket path < %s > is too long\n", path);
+		return -1;
+	}
+	
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	unlink(path);
+	
+	if ( (fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1 ||
+		bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || 
+		listen(fd, SOMAXCONN) == -1)
+	{
+		fprintf(stderr, "Err: can't listen on < %s >: %s\n", path, strerror(errno));
+		if (fd != -1)
+			close(fd);
+		return -1;
+	}
+	
+	return fd;
+}
+
+static void * worker(void * arg)
+{
+	/* take jobs until the server quits */
+	server * srv = (server *)arg;
+	uint64_t one = 1;
+	comp_expr cexp;
+	Context ctx;
+	conn * cn;
+	bool wake;
+	
+	comp_init(&cexp);
+	context_init(&ctx);
+	ctx.verbose = false;
+	ctx.f_prec = srv->f_prec;
+	ctx.keep_stats = srv->stats;
+	
+	while (true)
+	{
+		pthread_mutex_lock(&srv->lock);
+		while (NULL == srv->jobs && !srv->quit)
+			pthread_cond_wait(&srv->has_job, &srv->lock);
+		if (NULL == (cn = srv->jobs))
+		{
+			pthread_mutex_unlock(&srv->lock);
+			break;
+		}
+		if (NULL == (srv->jobs = cn->next))
+			srv->jobs_tail = &srv->jobs;
+		pthread_mutex_unlock(&srv->lock);
+		
+		batch_lines(&ctx, &cexp, cn->job.text, cn->job.text + cn->job.len, &cn->res, true);
+		cn->job.len = 0;
+		
+		// one wake up is enough for a done list which was empty
+		pthread_mutex_lock(&srv->lock);
+		wake = (NULL == srv->done);
+		cn->next = srv->done;
+		srv->done = cn;
+		pthread_mutex_unlock(&srv->lock);
+		if (wake && write(srv->wake_fd, &one, sizeof(one)) != sizeof(one))
+			perror("Err: eventfd");
+	}
+	
+	pthread_mutex_lock(&srv->lock);
+	stats_add(&srv->total, &ctx.stats);
+	pthread_mutex_unlock(&srv->lock);
+	
+	context_destroy(&ctx);
+	comp_destroy(&cexp);
+	return NULL;
+}
+
+static void conn_accept(int epfd, int lfd)
+{
+	/* take all that are waiting */
+	struct epoll_event ev;
+	conn * cn;
+	int fd;
+	
+	while ( (fd = accept4(lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+	{
+		if ( (cn = calloc(1, sizeof(*cn))) == NULL)
+		{
+			close(fd);
+			continue;
+		}
+		
+		cn->fd = fd;
+		cn->events = EPOLLIN;
+		ev.events = cn->events;
+		ev.data.ptr = cn;
+		if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1)
+		{
+			close(fd);
+			free(cn);
+		}
+	}
+	
+	return;
+}
+
+static bool conn_read(conn * cn)
+{
+	/* until there's nothing more for now */
+	ssize_t got;
+	
+	while (true)
+	{
+		if (buff_reserve(&cn->in, READ_SIZE) != 0)
+			return false;
+		
+		if ( (got = read(cn->fd, cn->in.text + cn->in.len, READ_SIZE)) > 0)
+		{
+			cn->in.len += got;
+			// let the others have a go before reading more
+			if (cn->in.len >= IN_HIGH)
+				return true;
+		}
+		else if (0 == got)
+			return false;
+		else if (EAGAIN == errno || EWOULDBLOCK == errno)
+			return true;
+		else if (errno != EINTR)
+		{
+			// nobody to send the results to
+			conn_drop(cn);
+			return false;
+		}
+	}
+}
+
+static bool conn_write(conn * cn)
+{
+	/* until it's all sent, or the socket is full */
+	ssize_t put;
+	
+	while (cn->sent < cn->out.len)
+	{
+		put = send(cn->fd, cn->out.text + cn->sent, cn->out.len - cn->sent, MSG_NOSIGNAL);
+		if (put > 0)
+			cn->sent += put;
+		else if (put == -1 && EINTR == errno)
+			continue;
+		else
+			return (put == -1 && (EAGAIN == errno || EWOULDBLOCK == errno));
+	}
+	
+	cn->out.len = cn->sent = 0;
+	return true;
+}
+
+static void conn_drop(conn * cn)
+{
+	/* the job can't be taken back from the workers; its results are dropped when
+	 * they come */
+	cn->eof = true;
+	cn->in.len = 0;
+	cn->out.len = cn->sent = 0;
+	return;
+}
+
+static void conn_dispatch(server * srv, conn * cn)
+{
+	/* the whole lines, and the last one without a new line after eof */
+	size_t len;
+	
+	if (cn->busy || 0 == cn->in.len || cn->out.len - cn->sent >= OUT_HIGH)
+		return;
+	
+	len = cn->in.len;
+	if (!cn->eof)
+	{
+		while (len > 0 && cn->in.text[len - 1] != '\n')
+			--len;
+		if (0 == len)
+			return;
+	}
+	
+	if (buff_reserve(&cn->job, len) != 0)
+	{
+		conn_drop(cn);
+		return;
+	}
+	memcpy(cn->job.text, cn->in.text, len);
+	cn->job.len = len;
+	memmove(cn->in.text, cn->in.text + len, cn->in.len - len);
+	cn->in.len -= len;
+	
+	cn->busy = true;
+	pthread_mutex_lock(&srv->lock);
+	cn->next = NULL;
+	*srv->jobs_tail = cn;
+	srv->jobs_tail = &cn->next;
+	pthread_cond_signal(&srv->has_job);
+	pthread_mutex_unlock(&srv->lock);
+	
+	return;
+}
+
+static void conn_update(int epfd, conn * cn)
+{
+	/* reading stops while there's too much waiting on either side */
+	struct epoll_event ev;
+	unsigned events = 0;
+	
+	if (cn->busy)
+	{
+		// the workers have it; the results will decide
+		if (!cn->eof && cn->in.len < IN_HIGH)
+			events |= EPOLLIN;
+	}
+	else if (cn->eof && 0 == cn->in.len && cn->sent == cn->out.len)
+	{
+		conn_close(cn);
+		return;
+	}
+	else if (!cn->eof && cn->out.len - cn->sent < OUT_HIGH)
+		events |= EPOLLIN;
+	
+	if (cn->sent < cn->out.len)
+		events |= EPOLLOUT;
+	
+	if (events != cn->events)
+	{
+		ev.events = events;
+		ev.data.ptr = cn;
+		if (0 == events)
+			epoll_ctl(epfd, EPOLL_CTL_DEL, cn->fd, NULL);
+		else
+			epoll_ctl(epfd, (0 == cn->events) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, cn->fd, &ev);
+		cn->events = events;
+	}
+	
+	return;
+}
+
+static void conn_close(conn * cn)
+{
+	/* closing the socket takes it out of epoll, if it's still there */
+	close(cn->fd);
+	free(cn->in.text);
+	free(cn->job.text);
+	free(cn->res.text);
+	free(cn->out.text);
+	free(cn);
+	return;
+}
+
+static int buff_reserve(batch_buff * buff, size_t size)
+{
+	/* grow to at least double the size */
+	char * new_text;
+	size_t new_size;
+	
+	if (buff->len + size <= buff->size)
+		return 0;
+	
+	new_size = (buff->size * 2 > buff->len + size) ? buff->size * 2 : buff->len + size;
+	if ( (new_text = realloc(buff->text, new_size)) == NULL)
+		return -1;
+	buff->text = new_text;
+	buff->size = new_size;
+	
+	return 0;
+}
+#else
+int server_run(const char * path, int f_prec, bool stats)
+{
+	/* epoll is Linux only */
+	(void)f_prec;
+	(void)stats;
+	fprintf(stderr, "Err: can't listen on < %s >; the server runs only on Linux\n", path);
+	return -1;
+}
+#endif
@@ -0,0 +1,21 @@
+/* server.h -- interface for server.c */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <stdbool.h>
+
+int server_run(const char * path, int f_prec, bool stats);
+/*
+returns: 0 after a clean shutdown, -1 if the server couldn't be started
+
+description: Listens on the Unix domain socket path, which is replaced if it 
+exists, and evaluates the lines sent by any number of clients on as many worker 
+threads as there are processors. Every line gets back exactly one line: its 
+result, its error message on a single line, or an empty line if it's empty or 
+a comment. A client can send any number of lines without waiting for the 
+results, which come back in the order of the lines, so they can be matched by 
+counting. Runs until SIGINT or SIGTERM, removes path, and prints the stats summary 
+of all workers on stderr if stats is set. Linux only.
+*/
+#endif
@@ -6,8 +6,17 @@
 #include "stack.h"
 
 void stack_init(Stack * stack, void (*destroy)(void * data))
+{
+	/* initialize the stack with elements from the heap */
+	stack_init_pool(stack, destroy, NULL);
+	
+	return;
+}
+
+void stack_init_pool(Stack * stack, void (*destroy)(void * data), Pool * pool)
 {
 	/* initialize the stack */
+	stack->pool = pool;
 	stack->size = 0;
 	stack->destroy = destroy;
 	stack->head = NULL;
@@ -37,7 +46,12 @@ int stack_push(Stack * stack, const void * data)
 	StackElmt * new_element;
 	
 	// allocate storage
-	if ( (new_element = (StackElmt *)malloc(sizeof(*new_element))) == NULL )
+	if (stack->pool != NULL)
+		new_element = (StackElmt *)pool_alloc(stack->pool);
+	else
+		new_element = (StackElmt *)malloc(sizeof(*new_element));
+	
+	if (NULL == new_element)
 		return -1;
 	
 	new_element->data = (void *)data;
@@ -67,7 +81,10 @@ int stack_pop(Stack * stack, void ** data)
 	stack->head = stack->head->next;
 
 	// free element memory
-	free(old_element);
+	if (stack->pool != NULL)
+		pool_free(stack->pool, old_element);
+	else
+		free(old_element);
 	
 	// adjust size
 	stack->size--;
@@ -2,6 +2,7 @@
 #define STACK_H_
 
 #include <stdlib.h>
+#include "pool.h"
 
 /* structure for the elements */
 typedef struct StackElmt_ {
@@ -13,6 +14,7 @@ typedef struct StackElmt_ {
 typedef struct Stack_ {
 	int size;
 	void (*destroy)(void * data);
+	Pool * pool;
 	StackElmt * head;
 } Stack;
 
@@ -28,6 +30,16 @@ if elements must not be deallocated after the stack is destroyed.
 complexity: O(1) 
 */
 
+void stack_init_pool(Stack * stack, void (*destroy)(void * data), Pool * pool);
+/* 
+returns: nothing
+
+description: Same as stack_init, but the elements of stack are taken from pool instead of the heap. 
+pool must be initialized with a block size of at least sizeof(StackElmt).
+
+complexity: O(1) 
+*/
+
 void stack_destroy(Stack * stack);
 /*
 returns: nothing
@@ -0,0 +1,54 @@
+/* stats.c -- summary of the work done by the engine */
+/* the counts and times are kept by eval.c in the context when
+ * ctx->keep_stats is on; nothing is counted or timed otherwise */
+
+#include <time.h>
+#include "stats.h"
+
+// milliseconds in a second
+#define MS	1e3
+
+// nanoseconds in a second
+#define NS	1e9
+
+/* --------------- MAIN CODE --------------- */
+double stats_now(void)
+{
+	/* monotonic time in seconds */
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void stats_add(ctx_stats * to, const ctx_stats * from)
+{
+	/* everything but the peak is a sum */
+	to->exprs += from->exprs;
+	to->errors += from->errors;
+	to->evals += from->evals;
+	to->numbers += from->numbers;
+	to->operators += from->operators;
+	to->heap_calls += from->heap_calls;
+	to->t_compile += from->t_compile;
+	to->t_eval += from->t_eval;
+	if (from->peak_nums > to->peak_nums)
+		to->peak_nums = from->peak_nums;
+	return;
+}
+
+void stats_print(FILE * stream, const ctx_stats * st)
+{
+	/* times per expression only when there are any */
+	fprintf(stream, "stats:\n");
+	fprintf(stream, "expressions compiled: %ld, %ld with errors\n", st->exprs, st->errors);
+	fprintf(stream, "numbers: %ld, operators: %ld\n", st->numbers, st->operators);
+	fprintf(stream, "most numbers in one expression: %d\n", st->peak_nums);
+	fprintf(stream, "check and parse: %.3f ms", st->t_compile * MS);
+	if (st->exprs > 0)
+		fprintf(stream, ", %.0f ns per expression", st->t_compile / st->exprs * NS);
+	fprintf(stream, "\nevaluate: %.3f ms for %ld evaluations", st->t_eval * MS, st->evals);
+	if (st->evals > 0)
+		fprintf(stream, ", %.0f ns per evaluation", st->t_eval / st->evals * NS);
+	fprintf(stream, "\nheap calls for operator records, queues, and stacks: %ld\n", st->heap_calls);
+	return;
+}
@@ -0,0 +1,36 @@
+/* stats.h -- interface for stats.c */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+#include <stdio.h>
+#include "context.h"
+
+double stats_now(void);
+/*
+returns: the current time in seconds
+
+description: Monotonic; only differences make sense.
+
+complexity: O(1)
+*/
+
+void stats_add(ctx_stats * to, const ctx_stats * from);
+/*
+returns: nothing
+
+description: Adds the counts and times of from to to. The peak is the larger
+of the two.
+
+complexity: O(1)
+*/
+
+void stats_print(FILE * stream, const ctx_stats * st);
+/*
+returns: nothing
+
+description: Prints a summary of st on stream.
+
+complexity: O(1)
+*/
+#endif
@@ -0,0 +1,61 @@
+/* translate.c -- cleans up input lines before they're checked */
+/* works by copying every character to be kept over the first one which
+ * was dropped; EXPON_OP and QUIT are names when they begin one, so a name
+ * is copied whole, and the characters inside it are never translated; a
+ * lone EXPON_OP is an operator only after an operand, since '^' can't be
+ * anywhere else, so a cell called EXPON_OP can be read */
+
+#include "translate.h"
+
+// the last character of an operand
+#define ENDS_OPERAND(ch)	(isalnum((unsigned char)(ch)) || '_' == (ch) || '.' == (ch) || ')' == (ch))
+
+/* --------------- MAIN CODE --------------- */
+int translate(char * str, int * len, bool quit)
+{
+	/* in is always at or after out */
+	char * in, * out, * end = str + *len;
+	int ch, ret = 0;
+	
+	for (in = out = str; in < end; ++in)
+	{
+		ch = *in;
+		if (isspace((unsigned char)ch))
+			continue;
+		
+		if (COMMENT == ch)
+			break;
+		
+		if (IS_NAME_START(ch) && (in + 1 == end || !IS_NAME_START(*(in + 1))))
+		{
+			if (EXPON_OP == ch && out > str && ENDS_OPERAND(*(out - 1)))
+				ch = '^';
+			else if (quit && QUIT == ch)
+			{
+				*out++ = QUIT;
+				ret = -1;
+				break;
+			}
+		}
+		
+		if (IS_NAME_START(ch))
+		{
+			// copy the whole name
+			while (in + 1 < end && IS_NAME_CHAR(*(in + 1)))
+			{
+				if (out != in)
+					*out = *in;
+				++out;
+				++in;
+			}
+			ch = *in;
+		}
+		
+		if (out != in || ch != *in)
+			*out = ch;
+		++out;
+	}
+	
+	*len = out - str;
+	return ret;
+}
@@ -0,0 +1,37 @@
+/* translate.h -- interface for translate.c */
+
+#ifndef TRANSLATE_H_
+#define TRANSLATE_H_
+
+#include <stdbool.h>
+#include <ctype.h>
+
+// the comment character; everything else after it is ignored
+#define COMMENT		'#'
+
+// this gets translated to '^'
+#define EXPON_OP	'e'
+
+// quits interactive mode
+#define QUIT		'q'
+
+// names begin with a letter or _ and go on with letters, digits, and _
+#define IS_NAME_START(ch)	(isalpha((unsigned char)(ch)) || '_' == (ch))
+#define IS_NAME_CHAR(ch)	(isalnum((unsigned char)(ch)) || '_' == (ch))
+
+int translate(char * str, int * len, bool quit);
+/*
+returns: -1 if quit is set and a lone QUIT was found, 0 otherwise
+
+description: Cleans up the *len characters at str in place, the same way for every 
+front end: whitespace is dropped, COMMENT ends the text, and EXPON_OP after an 
+operand becomes '^' unless it begins a name, i.e. a letter or _ follows it. With 
+quit set, a QUIT which doesn't begin a name ends the text, and is kept as its 
+last character. *len is set to the 
+length of the text left at str; no '\0' is added. Nothing is written until a 
+character has to move or change, so a line which is clean already, but for 
+whitespace or a comment at its end, is only read.
+
+complexity: O(n)
+*/
+#endif
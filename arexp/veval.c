@@ -0,0 +1,281 @@
+/* veval.c -- evaluates a compiled expression over many rows */
+/* works by cutting the rows in blocks; every number slot of the expression
+ * gets a row of a matrix, as wide as a block, in which a literal is repeated
+ * and a variable is copied; the recorded operations are then performed on
+ * whole rows of the matrix, a few elements per instruction, so only the
+ * exponentiation is done one element at a time */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "errchk.h"
+#include "veval.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define HAVE_SSE2
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX
+#endif
+#endif
+
+// the widest block in rows
+#define BLOCK_MAX	256
+
+// the size of the matrix in bytes above which blocks get narrower,
+// so the matrix stays in the cache for long expressions
+#define MATRIX_BYTES	(256 * 1024)
+
+// performs op on n elements: d = a op b; unary minus uses a only
+typedef void (*op_kernel)(int op, double * d, const double * a, const double * b, int n);
+
+// one element at a time
+static void op_scalar(int op, double * d, const double * a, const double * b, int n);
+
+#ifdef HAVE_SSE2
+// two elements at a time
+static void op_sse2(int op, double * d, const double * a, const double * b, int n);
+#endif
+
+#ifdef HAVE_AVX
+// four elements at a time
+static void op_avx(int op, double * d, const double * a, const double * b, int n)
+	__attribute__((target("avx")));
+#endif
+
+// the best kernel for this processor and its name
+static op_kernel pick_kernel(const char ** name);
+
+// the width of a block for an expression with n_nums slots
+static int block_width(int n_nums);
+
+// makes sure ctx->rows has room for size doubles
+static int rows_reserve(Context * ctx, long size);
+
+/* --------------- MAIN CODE --------------- */
+int evaluate_rows(Context * ctx, const comp_expr * cexp, double * out, long n_rows)
+{
+	/* fill the matrix and perform the operations a block at a time */
+	const char * name;
+	op_kernel run_op = pick_kernel(&name);
+	const instr * ins, * end = cexp->code + cexp->n_code;
+	const var_load * ld;
+	double * mtx, * row;
+	long first;
+	int i, j, n, width;
+
+	if (comp_unbound(cexp) != NULL)
+		return -1;
+
+	width = block_width(cexp->n_nums);
+	if (rows_reserve(ctx, (long)width * cexp->n_nums) != 0)
+	{
+		errchk_start(ctx);
+		err_set(ctx, ERR_MEMORY, 0);
+		return -1;
+	}
+	mtx = ctx->rows;
+
+	for (first = 0; first < n_rows; first += n)
+	{
+		n = (n_rows - first < width) ? n_rows - first : width;
+
+		// literals across the block; the slots of variables are filled next
+		for (i = 0; i < cexp->n_nums; ++i)
+		{
+			row = mtx + (long)i * width;
+			for (j = 0; j < n; ++j)
+				row[j] = cexp->nums[i];
+		}
+
+		for (ld = cexp->loads; ld < cexp->loads + cexp->n_loads; ++ld)
+		{
+			memcpy(mtx + (long)ld->slot * width, cexp->vars[ld->var].src + first,
+			n * sizeof(*mtx));
+		}
+
+		for (ins = cexp->code; ins < end; ++ins)
+		{
+			run_op(ins->op, mtx + (long)ins->dst * width, mtx + (long)ins->lhs * width,
+			mtx + (long)ins->rhs * width, n);
+		}
+
+		memcpy(out + first, mtx + (long)cexp->result * width, n * sizeof(*out));
+	}
+
+	return 0;
+}
+
+const char * rows_kernel(void)
+{
+	/* same choice as evaluate_rows() */
+	const char * name;
+	pick_kernel(&name);
+	return name;
+}
+
+static op_kernel pick_kernel(const char ** name)
+{
+	/* the widest vectors the processor has */
+#ifdef HAVE_AVX
+	if (__builtin_cpu_supports("avx"))
+	{
+		*name = "avx";
+		return op_avx;
+	}
+#endif
+#ifdef HAVE_SSE2
+	*name = "sse2";
+	return op_sse2;
+#else
+	*name = "scalar";
+	return op_scalar;
+#endif
+}
+
+static void op_scalar(int op, double * d, const double * a, const double * b, int n)
+{
+	/* the same operations as evaluate() */
+	int i;
+
+	switch (op)
+	{
+		case UNARY_MINUS:
+			for (i = 0; i < n; ++i)
+				d[i] = -a[i];
+			break;
+		case '^':
+			for (i = 0; i < n; ++i)
+				d[i] = pow(a[i], b[i]);
+			break;
+		case '*':
+			for (i = 0; i < n; ++i)
+				d[i] = a[i] * b[i];
+			break;
+		case '/':
+			for (i = 0; i < n; ++i)
+				d[i] = a[i] / b[i];
+			break;
+		case '+':
+			for (i = 0; i < n; ++i)
+				d[i] = a[i] + b[i];
+			break;
+		default:
+			for (i = 0; i < n; ++i)
+				d[i] = a[i] - b[i];
+			break;
+	}
+
+	return;
+}
+
+#ifdef HAVE_SSE2
+static void op_sse2(int op, double * d, const double * a, const double * b, int n)
+{
+	/* negation flips the sign bit, just like -x does */
+	const __m128d sign = _mm_set1_pd(-0.0);
+	int i = 0;
+
+	switch (op)
+	{
+		case UNARY_MINUS:
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(d + i, _mm_xor_pd(_mm_loadu_pd(a + i), sign));
+			break;
+		case '*':
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(d + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+			break;
+		case '/':
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(d + i, _mm_div_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+			break;
+		case '+':
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(d + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+			break;
+		case '-':
+			for (; i + 2 <= n; i += 2)
+				_mm_storeu_pd(d + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+			break;
+		default:
+			// no vector pow()
+			break;
+	}
+
+	// whatever is left
+	op_scalar(op, d + i, a + i, b + i, n - i);
+	return;
+}
+#endif
+
+#ifdef HAVE_AVX
+static void op_avx(int op, double * d, const double * a, const double * b, int n)
+{
+	/* same as op_sse2() with twice the width */
+	const __m256d sign = _mm256_set1_pd(-0.0);
+	int i = 0;
+
+	switch (op)
+	{
+		case UNARY_MINUS:
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(d + i, _mm256_xor_pd(_mm256_loadu_pd(a + i), sign));
+			break;
+		case '*':
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(d + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+			break;
+		case '/':
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(d + i, _mm256_div_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+			break;
+		case '+':
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(d + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+			break;
+		case '-':
+			for (; i + 4 <= n; i += 4)
+				_mm256_storeu_pd(d + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+			break;
+		default:
+			break;
+	}
+
+	op_scalar(op, d + i, a + i, b + i, n - i);
+	return;
+}
+#endif
+
+static int block_width(int n_nums)
+{
+	/* a multiple of four between 4 and BLOCK_MAX */
+	long width = MATRIX_BYTES / ((long)n_nums * sizeof(double));
+
+	if (width > BLOCK_MAX)
+		width = BLOCK_MAX;
+	width -= width % 4;
+	if (width < 4)
+		width = 4;
+
+	return width;
+}
+
+static int rows_reserve(Context * ctx, long size)
+{
+	/* grow to at least double the size */
+	double * new_rows;
+	long new_size;
+
+	if (size <= ctx->rows_size)
+		return 0;
+
+	new_size = (ctx->rows_size * 2 > size) ? ctx->rows_size * 2 : size;
+	if ( (new_rows = realloc(ctx->rows, new_size * sizeof(*new_rows))) == NULL)
+		return -1;
+	ctx->rows = new_rows;
+	ctx->rows_size = new_size;
+
+	return 0;
+}
@@ -0,0 +1,31 @@
+/* veval.h -- interface for veval.c */
+
+#ifndef VEVAL_H_
+#define VEVAL_H_
+
+#include "context.h"
+#include "eval.h"
+
+int evaluate_rows(Context * ctx, const comp_expr * cexp, double * out, long n_rows);
+/*
+returns: 0 on success, -1 if a variable of cexp is not bound, or if memory
+can't be allocated, in which case ctx->err_code is ERR_MEMORY
+
+description: Evaluates cexp for n_rows rows and saves the results in out. The
+value of a variable in row i is element i of the array it's bound to with
+comp_bind(). The rows are done in blocks; every operation of cexp is performed
+on a whole block at a time with SIMD instructions when the processor has them,
+so the cost of a row is a few instructions per operation. The results are the
+same as those of evaluate(). Nothing is printed, whatever ctx->verbose is.
+
+complexity: O(n_rows * number of operations)
+*/
+
+const char * rows_kernel(void);
+/*
+returns: the name of the instruction set used by evaluate_rows(); one of
+"avx", "sse2", "scalar"
+
+description: For the curious.
+*/
+#endif
@@ -0,0 +1,83 @@
+/* vstack.c -- an implementation of a stack in a growing array */
+
+#include <stdlib.h> // for NULL
+#include <string.h> // for memset()
+#include "vstack.h"
+
+// the first size of the buffer
+#define VSTACK_MIN_CAP	16
+
+void vstack_init(VStack * stack, void (*destroy)(void * data))
+{
+	/* initialize the stack */
+	stack->size = 0;
+	stack->destroy = destroy;
+	stack->buff = NULL;
+	stack->cap = 0;
+	
+	return;
+}
+
+void vstack_destroy(VStack * stack)
+{
+	/* remove each element */
+	void * data;
+	
+	while (stack->size > 0)
+	{
+		if ( (vstack_pop(stack, (void **)&data) == 0) && (stack->destroy != NULL) )
+			stack->destroy(data);
+	}
+	free(stack->buff);
+	// zero out memory of the structure
+	memset(stack, 0, sizeof(*stack));
+	
+	return;
+}
+
+void vstack_clear(VStack * stack)
+{
+	/* forget the elements, keep the buffer */
+	stack->size = 0;
+	
+	return;
+}
+
+int vstack_push(VStack * stack, const void * data)
+{
+	/* insert on top */
+	void ** new_buff;
+	int new_cap;
+	
+	// double the buffer when it's full
+	if (stack->size == stack->cap)
+	{
+		new_cap = (stack->cap > 0) ? stack->cap * 2 : VSTACK_MIN_CAP;
+		if ( (new_buff = realloc(stack->buff, new_cap * sizeof(*new_buff))) == NULL)
+			return -1;
+		stack->buff = new_buff;
+		stack->cap = new_cap;
+	}
+	
+	stack->buff[stack->size] = (void *)data;
+	
+	// update size
+	stack->size++;
+	
+	return 0;
+}
+
+int vstack_pop(VStack * stack, void ** data)
+{
+	/* remove the top element */
+	
+	// don't pop from an empty stack
+	if (0 == stack->size)
+		return -1;
+	
+	// adjust size and take the top
+	stack->size--;
+	*data = stack->buff[stack->size];
+	
+	return 0;
+}
@@ -0,0 +1,77 @@
+#ifndef VSTACK_H_
+#define VSTACK_H_
+
+#include <stdlib.h>
+
+/* structure for the vector stack
+ * the elements are kept in buff, which has room for cap of them; 
+ * the top is buff[size - 1] */
+typedef struct VStack_ {
+	int size;
+	void (*destroy)(void * data);
+	void ** buff;
+	int cap;
+} VStack;
+
+/* public interface */
+void vstack_init(VStack * stack, void (*destroy)(void * data));
+/* 
+returns: nothing
+
+description: Initializes the stack specified by stack. Must be called before stack can be used. 
+destroy provides a user defined way of freeing memory when vstack_destroy is called. destroy can be NULL
+if elements must not be deallocated after the stack is destroyed. No memory is allocated until the 
+first element is pushed.
+
+complexity: O(1) 
+*/
+
+void vstack_destroy(VStack * stack);
+/*
+returns: nothing
+
+description: Destroys stack by calling destroy provided in vstack_init, if it's not NULL, and frees 
+its buffer. No other operations are permitted after calling vstack_destroy.
+
+complexity: O(n)
+*/
+
+void vstack_clear(VStack * stack);
+/*
+returns: nothing
+
+description: Removes every element of stack without calling destroy. The buffer is kept, so a stack 
+which is cleared and filled again allocates nothing once it's big enough.
+
+complexity: O(1)
+*/
+
+int vstack_push(VStack * stack, const void * data);
+/*
+returns: 0 on success, -1 on failure
+
+description: Pushes an element on the stack. The buffer doubles when it's full.
+
+complexity: O(1) amortized
+*/
+
+int vstack_pop(VStack * stack, void ** data);
+/*
+returns: 0 on success, -1 on failure
+
+description: Pops an element from the stack. Upon return, data points to the data stored in the 
+element that was popped. The caller manages memory.
+
+complexity: O(1)
+*/
+
+#define vstack_peek(stack) ((stack)->size == 0 ? NULL : (stack)->buff[(stack)->size - 1])
+/*
+returns: pointer to the data on top of the stack, or NULL if stack is empty.
+
+description: Macro for peeking in the stack.
+
+complexity: O(1)
+*/
+
+#endif